@@ -3,18 +3,21 @@ import javax.swing.JComponent;
 import java.awt.Graphics;
 import java.awt.Graphics2D;
 import java.awt.geom.Rectangle2D;
+import java.awt.geom.Line2D;
 import java.awt.Color;
 
 /**
  * This class extends JPanel and represents one of the two graphs that are part of the GUI for
  * Part I.  This same class is used for both the fourier values and the samples values.  It
  * displays a graph similar to a bar graph of the given samples.  It also automatically scales
- * the data to fit in the window and mostly fill it.
+ * the data to fit in the window and mostly fill it.  It can also show the envelope of a whole
+ * file, drawing the range of the samples and their RMS level for each pixel.
  */
 public class GraphDisplay extends JPanel
 {
 
 	private double[] samples;
+	private double[] envelope;		//min, max and RMS for each pixel, null unless showing one
 	private int window_size;
 	
 	/**
@@ -32,6 +35,17 @@ public class GraphDisplay extends JPanel
 	public void updateSamples(double[] newSamples)
 	{
 		samples = newSamples;
+		envelope = null;
+		repaint();
+	}
+	
+	/**
+	 * Resets this display with an envelope from SoundInfo.get_envelope_vals().  It holds
+	 * the minimums, then the maximums, then the RMS values, one of each per pixel.
+	 */
+	public void updateEnvelope(double[] newEnvelope)
+	{
+		envelope = newEnvelope;
 		repaint();
 	}
 	
@@ -50,6 +64,16 @@ public class GraphDisplay extends JPanel
 		
 		setBackground(Color.WHITE);
 		
+		if(envelope != null)
+		{
+			paintEnvelope(g2);
+			return;
+		}
+		if(samples == null)
+		{
+			return;
+		}
+		
 		// width divided by window size +1 to make things line up right
 		double barWidth = (getWidth() / window_size) + 1;		
 		double barHeight = 0.0f;
@@ -86,4 +110,43 @@ public class GraphDisplay extends JPanel
 		}
 		
 	}
+	
+	/**
+	 * Draws the envelope.  Each pixel gets a vertical line from its smallest to its largest
+	 * sample, and the RMS level is drawn around the middle of the range.
+	 */
+	private void paintEnvelope(Graphics2D g2)
+	{
+		int width = envelope.length / 3;
+		double low = envelope[0];
+		double high = envelope[width];
+		
+		//Scale so the whole range of the file fits
+		for(int i=0; i<width; i++)
+		{
+			low = Math.min(low, envelope[i]);
+			high = Math.max(high, envelope[width + i]);
+		}
+		double middle = (low + high) / 2;
+		double scaleFactor = (high - low) / (getHeight() - 5);
+		if(scaleFactor <= 0)
+		{
+			scaleFactor = 1;
+		}
+		double xScale = (double)getWidth() / width;
+		
+		for(int i=0; i<width; i++)
+		{
+			double x = i * xScale;
+			double top = getHeight() - 2 - (envelope[width + i] - low) / scaleFactor;
+			double bottom = getHeight() - 2 - (envelope[i] - low) / scaleFactor;
+			g2.setPaint(Color.LIGHT_GRAY);
+			g2.draw(new Line2D.Double(x, top, x, bottom));
+			
+			double rms = envelope[2*width + i] / scaleFactor;
+			double center = getHeight() - 2 - (middle - low) / scaleFactor;
+			g2.setPaint(Color.DARK_GRAY);
+			g2.draw(new Line2D.Double(x, center - rms, x, center + rms));
+		}
+	}
 }
@@ -25,6 +25,78 @@ JNIEXPORT jintArray JNICALL Java_SoundInfo_get_1samples
 JNIEXPORT jdoubleArray JNICALL Java_SoundInfo_calc_1fourier
   (JNIEnv *, jclass, jintArray, jint, jint);
 
+/*
+ * Class:     SoundInfo
+ * Method:    get_num_frames
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_get_1num_1frames
+  (JNIEnv *, jclass, jstring);
+
+/*
+ * Class:     SoundInfo
+ * Method:    get_envelope
+ * Signature: (Ljava/lang/String;III)[D
+ */
+JNIEXPORT jdoubleArray JNICALL Java_SoundInfo_get_1envelope
+  (JNIEnv *, jclass, jstring, jint, jint, jint);
+
+/*
+ * Class:     SoundInfo
+ * Method:    calc_spectrum
+ * Signature: ([III[DZ)V
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_calc_1spectrum
+  (JNIEnv *, jclass, jintArray, jint, jint, jdoubleArray, jboolean);
+
+/*
+ * Class:     SoundInfo
+ * Method:    fill_samples
+ * Signature: (ILjava/lang/String;Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_fill_1samples
+  (JNIEnv *, jclass, jint, jstring, jobject);
+
+/*
+ * Class:     SoundInfo
+ * Method:    calc_spectrum_buffer
+ * Signature: (Ljava/nio/ByteBuffer;II[DZ)V
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_calc_1spectrum_1buffer
+  (JNIEnv *, jclass, jobject, jint, jint, jdoubleArray, jboolean);
+
+/*
+ * Class:     SoundInfo
+ * Method:    open_file
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_SoundInfo_open_1file
+  (JNIEnv *, jclass, jstring);
+
+/*
+ * Class:     SoundInfo
+ * Method:    close_file
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_close_1file
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     SoundInfo
+ * Method:    read_window
+ * Signature: (JILjava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_read_1window
+  (JNIEnv *, jclass, jlong, jint, jobject);
+
+/*
+ * Class:     SoundInfo
+ * Method:    poll_spectrum
+ * Signature: (Ljava/lang/String;IIILjava/nio/ByteBuffer;[D)I
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_poll_1spectrum
+  (JNIEnv *, jclass, jstring, jint, jint, jint, jobject, jdoubleArray);
+
 #ifdef __cplusplus
 }
 #endif
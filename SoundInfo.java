@@ -1,4 +1,7 @@
 import java.lang.Integer;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
 
 /**
  * This class holds information about a sound file that is needed for Part I.  It uses
@@ -11,12 +14,27 @@ public class SoundInfo
 	
 	private String fileName = "";		//Should never be "" other than when first created
 	private int firstSample = -1;		//Should never be -1 other than when first created
-	private int[] sample_vals;
+	private boolean ready = false;		//Whether the values are for fileName and firstSample
+	private long fileHandle = 0;		//Native handle for fileName, 0 if it couldn't be opened
+	private ByteBuffer sample_buffer;	//Direct, so the native code writes the samples in place
+	private IntBuffer sample_vals;
 	private double[] sample_vals_fl;
 	private double[] fourier_vals;	
 	
 	static native int[] get_samples(int number, int start, String fileName);
 	static native double[] calc_fourier(int[] samples, int windowSize, int k);
+	static native int get_num_frames(String fileName);
+	static native double[] get_envelope(String fileName, int start, int end, int width);
+	static native void calc_spectrum(int[] samples, int windowSize, int numBins, double[] out,
+										boolean complex);
+	static native int fill_samples(int start, String fileName, ByteBuffer buffer);
+	static native void calc_spectrum_buffer(ByteBuffer samples, int windowSize, int numBins,
+											double[] out, boolean complex);
+	static native long open_file(String fileName);
+	static native void close_file(long handle);
+	static native int read_window(long handle, int start, ByteBuffer buffer);
+	static native int poll_spectrum(String fileName, int start, int windowSize, int numBins,
+									ByteBuffer samples, double[] out);
 	static
 	{
 		String curPath = new java.io.File(".").getAbsolutePath();
@@ -31,6 +49,10 @@ public class SoundInfo
 	{
 		fourier_vals = new double[window_size/2];
 		sample_vals_fl = new double[window_size];
+		//One extra int on the end for the sample rate
+		sample_buffer = ByteBuffer.allocateDirect((window_size + 1) * 4);
+		sample_buffer.order(ByteOrder.nativeOrder());
+		sample_vals = sample_buffer.asIntBuffer();
 		recalc_info(pFileName, pFirstSample);
 	}
 	
@@ -52,41 +74,108 @@ public class SoundInfo
 	
 	/**
 	 * Do the work to get samples from the file and calculate the fourier transform of them.
-	 * Uses jni to call c functions to do this.
+	 * Uses jni to call c functions to do this.  The work is done on a native worker thread,
+	 * so this returns right away.  It returns true if the new values are already there (they
+	 * were cached, or nothing changed), and false if poll() has to be called until they are.
 	 */
-	public void recalc_info(String pFileName, int pFirstSample)
+	public boolean recalc_info(String pFileName, int pFirstSample)
 	{	
 		if(!(fileName.equals(pFileName)) || (firstSample != pFirstSample))
 		{
+			//Keep the file open natively while it's the one being looked at, so moving the
+			//window is just a copy from memory instead of reopening and parsing the file
+			if(!(fileName.equals(pFileName)))
+			{
+				close();
+				fileHandle = open_file(pFileName);
+			}
 			fileName = pFileName;
 			firstSample = pFirstSample;
-			
-			//First get samples and the file frequency
-			sample_vals = get_samples(window_size, pFirstSample, fileName);
-			//We need to store them as doubles also so we can return them
-			for(int i=0; i<window_size; i++)
+			ready = false;
+		}	
+		//If the file and the starting sample are the same, there's no reason to update anything
+		return poll();
+	}
+	
+	/**
+	 * Checks whether the worker thread has finished the window asked for by recalc_info, and
+	 * if so updates the values returned by get_sample_vals and get_fourier_vals.  Returns true
+	 * once they are up to date.
+	 */
+	public boolean poll()
+	{
+		if(ready)
+		{
+			return true;
+		}
+		
+		int state = poll_spectrum(fileName, firstSample, window_size,
+									(int)(0.5*(window_size-1)), sample_buffer, fourier_vals);
+		if(state == 0)
+		{
+			return false;
+		}
+		if(state < 0)
+		{
+			//The worker couldn't open the file (standard input can't be mapped, for one), so
+			//do it here the old way
+			if(fileHandle != 0)
+			{
+				read_window(fileHandle, firstSample, sample_buffer);
+			}
+			else
 			{
-				//This is the best way I came up with to handle overflow.  Java doesn't
-				//have unsigned ints, so we use doubles and manually correct for overflow.
-				double curVal = sample_vals[i];
-				double offset = Integer.MAX_VALUE;
-				offset += Integer.MAX_VALUE;
-				
-				if(curVal < 0)
-				{
-					curVal += offset;
-				}
-				sample_vals_fl[i] = curVal;
+				fill_samples(firstSample, fileName, sample_buffer);
 			}
+			//Calculate the fourier transforms, all the bins in one native call
+			calc_spectrum_buffer(sample_buffer, window_size, (int)(0.5*(window_size-1)),
+									fourier_vals, false);
+		}
+		
+		//We need to store them as doubles also so we can return them
+		for(int i=0; i<window_size; i++)
+		{
+			//This is the best way I came up with to handle overflow.  Java doesn't
+			//have unsigned ints, so we use doubles and manually correct for overflow.
+			double curVal = sample_vals.get(i);
+			double offset = Integer.MAX_VALUE;
+			offset += Integer.MAX_VALUE;
 			
-			//Calculate the fourier transforms
-			double[] complex = new double[2];
-			for(int k=0; k<(int)(0.5*(window_size-1)); k++)
+			if(curVal < 0)
 			{
-				complex = calc_fourier(sample_vals, window_size, k);
-				fourier_vals[k] = Math.sqrt((Math.pow(complex[0], 2) + Math.pow(complex[1], 2)));
+				curVal += offset;
 			}
-		}	
-		//If the file and the starting sample are the same, there's no reason to update anything
+			sample_vals_fl[i] = curVal;
+		}
+		ready = true;
+		return true;
+	}
+	
+	/**
+	 * Closes the native handle for the current file.  recalc_info opens it again if needed.
+	 */
+	public void close()
+	{
+		if(fileHandle != 0)
+		{
+			close_file(fileHandle);
+			fileHandle = 0;
+		}
+	}
+	
+	/**
+	 * Returns the envelope of the whole file drawn "width" pixels wide, or null if the file
+	 * isn't valid.  The array holds "width" minimums, then "width" maximums, then "width" RMS
+	 * values.  The native code keeps a min/max/RMS index of the file, so this doesn't read
+	 * the samples again no matter how long the file is.
+	 */
+	public double[] get_envelope_vals(int width)
+	{
+		int frames = get_num_frames(fileName);
+		if(frames <= 0 || width <= 0)
+		{
+			return null;
+		}
+		return get_envelope(fileName, 0, frames, width);
 	}
-}
\ No newline at end of file
+}
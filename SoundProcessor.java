@@ -5,6 +5,7 @@ import javax.swing.JPanel;
 import javax.swing.JSlider;
 import javax.swing.JButton;
 import javax.swing.JLabel;
+import javax.swing.Timer;
 import javax.swing.event.ChangeEvent;
 import javax.swing.event.ChangeListener;
 
@@ -23,13 +24,16 @@ import java.awt.Color;
  * This class is the main GUI class for part I.  It allows the user to choose a file to load
  * and then displays two graphs relating to the data in that file.  It also provides a slider
  * for the user to control the starting sample.  The top graph shows the samples in the file, 
- * and the bottom graph shows the fourier transform of those samples.
+ * and the bottom graph shows the fourier transform of those samples.  Below them is an overview
+ * of the waveform of the whole file.
  */ 
 public class SoundProcessor extends JPanel implements ChangeListener,
 										 			ActionListener
 {
 	static final int SAMPLE_MIN = 0;
 	static final int window_size = 256;
+	//How often to check whether the spectrum being worked on in the background is ready
+	static final int POLL_DELAY = 20;
 	private static int SAMPLE_MAX = 100;
 	private static int curSample = 0;
 	private static String fileName = "";
@@ -38,11 +42,14 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 	private static JLabel sliderLabel;
 	private static JLabel samplesLabel;
 	private static JLabel fourierLabel;
+	private static JLabel overviewLabel;
 	private static JSlider startingSampleSlider;
 	private static SoundInfo soundInfo;
+	private static Timer pollTimer;
 	
 	private static GraphDisplay fourierDisplay;
 	private static GraphDisplay sampleDisplay;
+	private static GraphDisplay overviewDisplay;
 		
 	/**
 	 * Creates a new SoundProcessor.  Originally it just displays a button allowing the user
@@ -50,7 +57,7 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 	 */
 	public SoundProcessor()
 	{	
-		setSize(800, 600);
+		setSize(800, 720);
 		//Create and add the button
 		button = new JButton("Load sample");
 		button.setMnemonic(KeyEvent.VK_D);
@@ -86,7 +93,7 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 	{
 		topFrame = new JFrame("Sound Processor");
 		topFrame.setDefaultCloseOperation(JFrame.EXIT_ON_CLOSE);
-		topFrame.setSize(800, 600);
+		topFrame.setSize(800, 720);
 		
 		SoundProcessor sp = new SoundProcessor();
 		sp.setLayout(null);
@@ -98,26 +105,54 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 	}
 	
 	/**
-	 * Handles the action when the JSlider is moved. It purposefully only updates the display
-	 * when the slider is released after it has changed.  I chose to do it this way because
-	 * I think it makes more sense to let the user place the slider and then update the 
-	 * display.  Also, with large files the display might get sluggish if I tried to update it
-	 * as it was moving.
+	 * Handles the action when the JSlider is moved.  The displays follow the slider while it's
+	 * being dragged.  The samples and fourier transform are worked out on a background thread
+	 * and cached, so this never waits for them; the displays are updated when they're ready,
+	 * and going back to a position that has already been seen is instant.
 	 */
 	public void stateChanged(ChangeEvent e)
 	{
 		JSlider source = (JSlider)e.getSource();
-		if(!source.getValueIsAdjusting())
+		if(source.getValue() != curSample)
 		{
 			curSample = source.getValue();
 			/*Update the SoundInfo object with the new starting sample.*/
-			soundInfo.recalc_info(fileName, curSample);
-			/*Update each of the two displays with the new SoundInfo object*/
-			sampleDisplay.updateSamples(soundInfo.get_sample_vals());
-			fourierDisplay.updateSamples(soundInfo.get_fourier_vals());
+			showWhenReady(soundInfo.recalc_info(fileName, curSample));
 		}
 	}
 	
+	/**
+	 * Updates the two displays right away if "ready" is true.  Otherwise starts the timer that
+	 * keeps checking until the values from the background thread are ready.
+	 */
+	private void showWhenReady(boolean ready)
+	{
+		if(ready)
+		{
+			if(pollTimer != null)
+			{
+				pollTimer.stop();
+			}
+			updateDisplays();
+			return;
+		}
+		if(pollTimer == null)
+		{
+			pollTimer = new Timer(POLL_DELAY, this);
+			pollTimer.setActionCommand("poll");
+		}
+		pollTimer.start();
+	}
+	
+	/**
+	 * Update each of the two displays with the values in the SoundInfo object.
+	 */
+	private void updateDisplays()
+	{
+		sampleDisplay.updateSamples(soundInfo.get_sample_vals());
+		fourierDisplay.updateSamples(soundInfo.get_fourier_vals());
+	}
+	
 	/**
 	 * Handles the action when the "load" button has been pressed.  It uses a JFileChooser
 	 * to allow the user to pick a file.  It then goes through and creates all the parts of
@@ -125,6 +160,16 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 	 */
 	public void actionPerformed(ActionEvent e)
 	{
+		if("poll".equals(e.getActionCommand()))
+		{
+			if(soundInfo.poll())
+			{
+				pollTimer.stop();
+				updateDisplays();
+			}
+			return;
+		}
+		
 		if("load".equals(e.getActionCommand()))
 		{	
 			JFileChooser open = new JFileChooser();
@@ -164,13 +209,15 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 			}
 			
 			//Create the soundInfo if it doesn't exist
+			boolean ready;
 			if(soundInfo == null)
 			{
-				soundInfo = new SoundInfo(fileName, 0);				
+				soundInfo = new SoundInfo(fileName, 0);
+				ready = soundInfo.poll();
 			}
 			else
 			{
-				soundInfo.recalc_info(fileName, curSample);
+				ready = soundInfo.recalc_info(fileName, curSample);
 			}
 			
 			//Create the sampleDisplay if it doesn't exist
@@ -189,8 +236,6 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 				samplesLabel.setVisible(true);
 				add(samplesLabel);
 			}
-			//Update
-			sampleDisplay.updateSamples(soundInfo.get_sample_vals());
 			
 			//Create the fourierDisplay if it doesn't exist, otherwise update
 			if(fourierDisplay == null)
@@ -208,8 +253,27 @@ public class SoundProcessor extends JPanel implements ChangeListener,
 				fourierLabel.setVisible(true);
 				add(fourierLabel);
 			}
-			//Update
-			fourierDisplay.updateSamples(soundInfo.get_fourier_vals());
+			//Update both displays now, or once the background thread has the values
+			showWhenReady(ready);
+			
+			//Create the overviewDisplay if it doesn't exist, otherwise update
+			if(overviewDisplay == null)
+			{
+				overviewDisplay = new GraphDisplay(window_size);
+				overviewDisplay.setVisible(true);
+				overviewDisplay.setLocation(20, 590);
+				overviewDisplay.setSize(760, 80);
+				add(overviewDisplay);
+				
+				//Also add the label
+				overviewLabel = new JLabel("Whole File");
+				overviewLabel.setLocation(0, 565);
+				overviewLabel.setSize(150, 25);
+				overviewLabel.setVisible(true);
+				add(overviewLabel);
+			}
+			//One envelope value for each pixel of the display
+			overviewDisplay.updateEnvelope(soundInfo.get_envelope_vals(overviewDisplay.getWidth()));
 			
 			//So that the changes will appear.
 			validate();
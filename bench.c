@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "input_lib.h"
+#include "util.h"
+#include "fourier.h"
+#include "mix_lib.h"
+#include "delay_lib.h"
+#include "sine_lib.h"
+#include "noise_lib.h"
+#include "perf_lib.h"
+
+/*Samples (counting both channels) in the synthetic data for the streaming kernels*/
+#define DEFAULT_SAMPLES (1 << 20)
+#define DEFAULT_REPEATS 7
+#define MAX_REPEATS 101
+/*Files mixed together by the mix benchmark*/
+#define MIX_FILES 2
+
+typedef struct bench_case *BenchCasePtr;
+
+/**
+ * One benchmark.  "run" does the work once on the case's data and "samples" is how many
+ * samples that is, so the time can be turned into a throughput.
+ */
+typedef struct bench_case
+{
+	const char *kernel;
+	int bit_size;
+	int channels;
+	int window_size;	/*Only for the fourier kernels, 0 otherwise*/
+	unsigned samples;
+	void (*run)(BenchCasePtr bc);
+
+	/*The data the kernel works on*/
+	unsigned *values;
+	FILE *files[MIX_FILES];
+	FILE *out;
+} BenchCase;
+
+static void make_data(unsigned *values, unsigned count, int bit_size, int channels);
+static FILE* data_file(const unsigned *values, unsigned count, int bit_size);
+static double time_case(BenchCasePtr bc, int repeats);
+static int compare_doubles(const void *a, const void *b);
+static void report(BenchCasePtr bc, double seconds);
+static void run_read_sample(BenchCasePtr bc);
+static void run_read_samples(BenchCasePtr bc);
+static void run_output_sample(BenchCasePtr bc);
+static void run_output_samples(BenchCasePtr bc);
+static void run_calc_fourier(BenchCasePtr bc);
+static void run_calc_spectrum(BenchCasePtr bc);
+static void run_mix_files(BenchCasePtr bc);
+static void run_delay(BenchCasePtr bc);
+
+/*Keeps the compiler from throwing away results that aren't otherwise used*/
+static volatile double sink;
+
+/**
+ * Bench
+ * Times the core kernels on synthetic data made with the same generators as gensine and
+ * static: reading and writing samples one at a time and in blocks, the fourier transform one
+ * bin at a time and all at once, mixing, and the reverb delay line.  Each one is run for every
+ * bit size and channel layout (and several window sizes for the fourier kernels).  Every case
+ * is run once to warm up and then "repeats" more times, and the median time is reported so a
+ * single slow run doesn't throw the numbers off.  If a kernel name is given only the cases for
+ * that kernel are run.
+ *
+ * Command Line Variables: bench [-r repeats] [-n samples] [kernel]
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	int bit_sizes[3] = {8, 16, 32};
+	int window_sizes[4] = {64, 256, 1000, 1024};
+	int repeats = DEFAULT_REPEATS;
+	unsigned num_samples = DEFAULT_SAMPLES;
+	const char *only = NULL;
+	BenchCase bc;
+	int i, b, c, w, f;
+
+	for(i=1; i<argc; i++)
+	{
+		if(strcmp(argv[i], "-r") == 0 && i+1 < argc)
+		{
+			repeats = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "-n") == 0 && i+1 < argc)
+		{
+			num_samples = atoi(argv[++i]);
+		}
+		else if(argv[i][0] != '-' && only == NULL)
+		{
+			only = argv[i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: bench [-r repeats] [-n samples] [kernel]\n");
+			return 1;
+		}
+	}
+	if(repeats < 1 || repeats > MAX_REPEATS || num_samples < 2)
+	{
+		fprintf(stderr, "The repeats must be from 1 to %d and there must be at least 2 samples.\n",
+					MAX_REPEATS);
+		return 1;
+	}
+	/*Whole frames only*/
+	num_samples = num_samples - num_samples % 2;
+
+	if((bc.out = fopen("/dev/null", "w")) == NULL)
+	{
+		fprintf(stderr, "Cannot open: /dev/null\n");
+		return 1;
+	}
+	bc.values = (unsigned*)perf_malloc(num_samples * sizeof(unsigned));
+	printf("%-16s %4s %8s %6s %10s %12s %12s %10s\n", "kernel", "bits", "channels", "window",
+				"samples", "median ms", "Msamples/s", "ns/sample");
+
+	for(b=0; b<3; b++)
+	{
+		for(c=1; c<=2; c++)
+		{
+			bc.bit_size = bit_sizes[b];
+			bc.channels = c;
+			bc.window_size = 0;
+			bc.samples = num_samples;
+			make_data(bc.values, num_samples, bc.bit_size, c);
+			for(f=0; f<MIX_FILES; f++)
+			{
+				bc.files[f] = data_file(bc.values, num_samples, bc.bit_size);
+			}
+
+			bc.kernel = "read_sample";
+			bc.run = run_read_sample;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+			bc.kernel = "read_samples";
+			bc.run = run_read_samples;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+			bc.kernel = "output_sample";
+			bc.run = run_output_sample;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+			bc.kernel = "output_samples";
+			bc.run = run_output_samples;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+			bc.kernel = "mix_files";
+			bc.run = run_mix_files;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+			bc.kernel = "delay_process";
+			bc.run = run_delay;
+			if(only == NULL || strcmp(only, bc.kernel) == 0)
+			{
+				report(&bc, time_case(&bc, repeats));
+			}
+
+			/*The fourier code only handles mono, so it only gets the one channel layout*/
+			for(w=0; w<4 && c == 1; w++)
+			{
+				bc.window_size = window_sizes[w];
+				bc.samples = window_sizes[w];
+				bc.kernel = "calc_fourier";
+				bc.run = run_calc_fourier;
+				if(only == NULL || strcmp(only, bc.kernel) == 0)
+				{
+					report(&bc, time_case(&bc, repeats));
+				}
+				bc.kernel = "calc_spectrum";
+				bc.run = run_calc_spectrum;
+				if(only == NULL || strcmp(only, bc.kernel) == 0)
+				{
+					report(&bc, time_case(&bc, repeats));
+				}
+			}
+
+			for(f=0; f<MIX_FILES; f++)
+			{
+				fclose(bc.files[f]);
+			}
+		}
+	}
+
+	free(bc.values);
+	fclose(bc.out);
+	return 0;
+}
+
+/**
+ * Fills "values" with a sine wave at 440 Hz plus some static, the same kind of signal gensine
+ * and static make, so the data looks like real sound instead of a constant.
+ */
+static void make_data(unsigned *values, unsigned count, int bit_size, int channels)
+{
+	SineProp sin_prop;
+	Oscillator osc;
+	unsigned *noise;
+	unsigned mid = 1u << (bit_size - 1);
+	unsigned i;
+
+	sin_prop.mono_or_stereo = MONO;
+	sin_prop.frequency = 440;
+	sin_prop.bit_size = bit_size;
+	sin_prop.sample_rate = 44100;
+	sin_prop.amplitude = mid / 2;
+	sin_prop.duration = (double)count / sin_prop.sample_rate;
+	osc_init(&osc, sin_prop.frequency, sin_prop.sample_rate);
+	fill_wave(&sin_prop, &osc, values, count);
+
+	/*Static at a quarter of full scale on top, so the values are spread out*/
+	noise = (unsigned*)perf_malloc(count * sizeof(unsigned));
+	noise_fill(channels, 0, noise, count, bit_size - 2);
+	for(i=0; i<count; i++)
+	{
+		values[i] = values[i] - mid / 8 + noise[i];
+	}
+	free(noise);
+}
+
+/**
+ * Writes the values to a temporary file with no header, so the readers can go through them
+ * just like the data part of a sound file.
+ */
+static FILE* data_file(const unsigned *values, unsigned count, int bit_size)
+{
+	FILE *file = tmpfile();
+
+	output_samples(file, values, count, bit_size);
+	fflush(file);
+	return file;
+}
+
+/**
+ * Runs the case once to warm up and then "repeats" times, and returns the median time in
+ * seconds.
+ */
+static double time_case(BenchCasePtr bc, int repeats)
+{
+	double times[MAX_REPEATS];
+	struct timespec start, end;
+	int i;
+
+	bc->run(bc);
+	for(i=0; i<repeats; i++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		bc->run(bc);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		times[i] = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+	}
+	qsort(times, repeats, sizeof(double), compare_doubles);
+	if(repeats % 2 == 0)
+	{
+		return (times[repeats/2 - 1] + times[repeats/2]) / 2;
+	}
+	return times[repeats/2];
+}
+
+/**
+ * Orders doubles from smallest to largest for qsort.
+ */
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Prints one line of the results table.
+ */
+static void report(BenchCasePtr bc, double seconds)
+{
+	printf("%-16s %4d %8s %6d %10u %12.3f %12.2f %10.2f\n", bc->kernel, bc->bit_size,
+				(bc->channels == 2) ? "STEREO" : "MONO", bc->window_size, bc->samples,
+				seconds * 1e3, bc->samples / seconds / 1e6, seconds * 1e9 / bc->samples);
+	fflush(stdout);
+}
+
+/**
+ * Reads the data file back one sample at a time.
+ */
+static void run_read_sample(BenchCasePtr bc)
+{
+	unsigned value, total = 0;
+	unsigned i;
+
+	rewind(bc->files[0]);
+	for(i=0; i<bc->samples; i++)
+	{
+		read_sample(bc->files[0], bc->bit_size, &value);
+		total += value;
+	}
+	sink = total;
+}
+
+/**
+ * Reads the data file back a block at a time, the way the streaming programs do.
+ */
+static void run_read_samples(BenchCasePtr bc)
+{
+	unsigned block[DELAY_BLOCK * 2];
+	unsigned total = 0;
+	int count;
+
+	rewind(bc->files[0]);
+	while((count = read_samples(bc->files[0], bc->bit_size, block, DELAY_BLOCK * 2)) > 0)
+	{
+		total += block[count - 1];
+	}
+	sink = total;
+}
+
+/**
+ * Writes the values out one sample at a time.
+ */
+static void run_output_sample(BenchCasePtr bc)
+{
+	unsigned i;
+
+	for(i=0; i<bc->samples; i++)
+	{
+		output_sample(bc->out, bc->values[i], bc->bit_size);
+	}
+}
+
+/**
+ * Writes the values out a block at a time.
+ */
+static void run_output_samples(BenchCasePtr bc)
+{
+	unsigned i, n;
+
+	for(i=0; i<bc->samples; i+=n)
+	{
+		n = (bc->samples - i < DELAY_BLOCK * 2) ? bc->samples - i : DELAY_BLOCK * 2;
+		output_samples(bc->out, bc->values + i, n, bc->bit_size);
+	}
+}
+
+/**
+ * Works out every bin of one window one at a time with calc_fourier, the way SoundInfo and
+ * dtmf used to.  The time per sample is for the whole spectrum of the window.
+ */
+static void run_calc_fourier(BenchCasePtr bc)
+{
+	double total = 0;
+	double *result;
+	int k;
+
+	for(k=0; k<bc->window_size; k++)
+	{
+		result = calc_fourier((int*)bc->values, bc->window_size, k);
+		total += result[0];
+		free(result);
+	}
+	sink = total;
+}
+
+/**
+ * Works out every bin of one window at once with calc_spectrum.
+ */
+static void run_calc_spectrum(BenchCasePtr bc)
+{
+	double *re = (double*)perf_malloc(bc->window_size * sizeof(double));
+	double *im = (double*)perf_malloc(bc->window_size * sizeof(double));
+
+	calc_spectrum((const int*)bc->values, bc->window_size, bc->window_size, re, im);
+	sink = re[1];
+	free(re);
+	free(im);
+}
+
+/**
+ * Mixes the data files together, written to /dev/null.
+ */
+static void run_mix_files(BenchCasePtr bc)
+{
+	FileInfo info[MIX_FILES];
+	FileInfoPtr input_info[MIX_FILES];
+	unsigned *converted[MIX_FILES];
+	int f;
+
+	for(f=0; f<MIX_FILES; f++)
+	{
+		info[f].mono_or_stereo = (bc->channels == 2) ? STEREO : MONO;
+		info[f].frequency = 44100;
+		info[f].bit_size = bc->bit_size;
+		info[f].num_samples = bc->samples;
+		info[f].header_stats = 0;
+		info[f].rel_gain = 1.0 / (f + 1);
+		input_info[f] = &info[f];
+		converted[f] = NULL;
+		rewind(bc->files[f]);
+	}
+	mix_files(input_info, bc->files, converted, MIX_FILES, bc->out);
+}
+
+/**
+ * Runs the data through a three echo delay line, the same as reverb does.
+ */
+static void run_delay(BenchCasePtr bc)
+{
+	DelayTap taps[3] = {{441, 50}, {1323, 30}, {4410, 20}};
+	DelayLinePtr dl = delay_create(taps, 3, bc->channels);
+	unsigned block[DELAY_BLOCK * 2];
+	unsigned i, n;
+
+	for(i=0; i<bc->samples; i+=n)
+	{
+		n = (bc->samples - i < DELAY_BLOCK * bc->channels) ?
+				bc->samples - i : DELAY_BLOCK * bc->channels;
+		memcpy(block, bc->values + i, n * sizeof(unsigned));
+		delay_process(dl, block, n / bc->channels);
+	}
+	sink = block[0];
+	delay_destroy(dl);
+}
@@ -0,0 +1,120 @@
+#!/bin/bash
+
+# This script measures how fast dtmf decodes button presses, in digits per CPU-second.  It
+# makes a corpus of dtmf sequences with "gendtmf" (the same thing gendtmf2.sh makes with
+# gensine, mix and merge), with different pauses and durations, and with "static" mixed in
+# at a low level for some of them.  The random numbers come from a fixed seed so the corpus
+# is always the same.  Every sequence is decoded once to check the digits are right, then
+# the whole corpus is decoded a few more times and timed.
+#
+# The result is compared with the one stored in benchdtmf.baseline.  The benchmark fails if
+# any digits are decoded wrong or if the throughput is more than 20% below the baseline.
+# Give "-update" as the first parameter to store the new result as the baseline.  The
+# baseline depends on the machine, so it should be updated when the benchmark is moved to a
+# different one.
+
+num_sequences=60
+passes=5
+tolerance=0.20
+seed=229
+baseline_file=benchdtmf.baseline
+
+BUTTONS=(1 2 3 A 4 5 6 B 7 8 9 C S 0 P D)
+PAUSES=(50 80 120 200)
+DURATIONS=(0.08 0.1 0.15 0.2)
+NOISE_GAINS=(0 0.01 0.02 0.03)
+
+update=0
+if [ "$1" = "-update" ]; then
+	update=1
+fi
+
+for program in gendtmf static mix info dtmf; do
+	if [ ! -x ./$program ]; then
+		echo "./$program is missing, run make first."
+		exit 1
+	fi
+done
+
+tempdir=$(mktemp -d)
+trap 'rm -r $tempdir' EXIT
+
+# Make the corpus.  The expected output of dtmf is kept next to each file.
+RANDOM=$seed
+total_digits=0
+for (( i=0; i<num_sequences; i++ )); do
+	num_buttons=$(( 3 + RANDOM % 8 ))
+	pause=${PAUSES[$(( RANDOM % 4 ))]}
+	duration=${DURATIONS[$(( RANDOM % 4 ))]}
+	gain=${NOISE_GAINS[$(( RANDOM % 4 ))]}
+	buttons=""
+	for (( j=0; j<num_buttons; j++ )); do
+		buttons="$buttons ${BUTTONS[$(( RANDOM % 16 ))]}"
+	done
+	total_digits=$(( total_digits + num_buttons ))
+
+	./gendtmf $pause $duration $buttons > $tempdir/tones$i.raw || exit 1
+	if [ $gain = 0 ]; then
+		mv $tempdir/tones$i.raw $tempdir/seq$i.raw
+	else
+		samples=$(./info -csv $tempdir/tones$i.raw | tail -n 1 | cut -d , -f 6)
+		./static 8 $samples 8000 $(( seed + i )) > $tempdir/noise$i.raw || exit 1
+		./mix $tempdir/tones$i.raw 1.0 $tempdir/noise$i.raw $gain > $tempdir/seq$i.raw || exit 1
+		rm $tempdir/tones$i.raw $tempdir/noise$i.raw
+	fi
+	echo $buttons | sed -e 's/S/*/g' -e 's/P/#/g' > $tempdir/expected$i
+done
+
+# Check that every sequence decodes to the buttons that were pressed
+correct_digits=0
+failed=0
+for (( i=0; i<num_sequences; i++ )); do
+	decoded=$(./dtmf < $tempdir/seq$i.raw | xargs)
+	expected=$(cat $tempdir/expected$i)
+	if [ "$decoded" = "$expected" ]; then
+		correct_digits=$(( correct_digits + $(echo "$expected" | wc -w) ))
+	else
+		echo "Sequence $i: expected \"$expected\" but got \"$decoded\""
+		failed=$(( failed + 1 ))
+	fi
+done
+
+# Time the decoding.  Only the CPU time of dtmf itself is counted.
+TIMEFORMAT="%3U %3S"
+cpu=$( { time ( for (( p=0; p<passes; p++ )); do
+		for (( i=0; i<num_sequences; i++ )); do
+			./dtmf < $tempdir/seq$i.raw > /dev/null
+		done
+	done ) ; } 2>&1 )
+throughput=$(echo $cpu | awk -v d=$(( total_digits * passes )) '{ printf "%.1f", d / ($1 + $2) }')
+
+echo "Sequences: $num_sequences  Digits: $total_digits  Decoded correctly: $correct_digits"
+echo "CPU seconds for $passes passes: $(echo $cpu | awk '{ print $1 + $2 }')"
+echo "Digits per CPU-second: $throughput"
+
+if [ $update -eq 1 ]; then
+	echo $throughput > $baseline_file
+	echo "Stored as the new baseline."
+fi
+
+result=0
+if [ $failed -ne 0 ]; then
+	echo "FAIL: $failed sequences were decoded wrong."
+	result=1
+fi
+if [ -f $baseline_file ]; then
+	baseline=$(cat $baseline_file)
+	minimum=$(awk -v b=$baseline -v t=$tolerance 'BEGIN { printf "%.1f", b * (1 - t) }')
+	echo "Baseline: $baseline  (must be at least $minimum)"
+	if awk -v x=$throughput -v m=$minimum 'BEGIN { exit !(x < m) }'; then
+		echo "FAIL: the throughput is below the baseline."
+		result=1
+	fi
+else
+	echo "No baseline stored, run with -update to store one."
+fi
+
+if [ $result -eq 0 ]; then
+	echo "PASS"
+fi
+exit $result
@@ -0,0 +1,133 @@
+#include "codec_lib.h"
+#include "util.h"
+#include <string.h>
+
+/*Reading and writing one little endian sample of each size*/
+#define LOAD_8(p) ((unsigned)(p)[0])
+#define LOAD_16(p) ((unsigned)(p)[0] | ((unsigned)(p)[1]<<8))
+#define LOAD_32(p) ((unsigned)(p)[0] | ((unsigned)(p)[1]<<8) | ((unsigned)(p)[2]<<16) | \
+						((unsigned)(p)[3]<<24))
+
+#define STORE_8(p, v) ((p)[0] = (unsigned char)(v))
+#define STORE_16(p, v) ((p)[0] = (unsigned char)(v), (p)[1] = (unsigned char)((v)>>8))
+#define STORE_32(p, v) ((p)[0] = (unsigned char)(v), (p)[1] = (unsigned char)((v)>>8), \
+						(p)[2] = (unsigned char)((v)>>16), (p)[3] = (unsigned char)((v)>>24))
+
+/**
+ * Makes unpack_<bits> and pack_<bits> for one bit size.  The sample size is a constant in
+ * each one, so the byte offsets are known and the loops vectorize.
+ */
+#define DEFINE_BIT_SIZE(BITS) \
+static void unpack_##BITS(const unsigned char * restrict bytes, unsigned * restrict samples, \
+							int count) \
+{ \
+	int i; \
+	for(i=0; i<count; i++) \
+	{ \
+		samples[i] = LOAD_##BITS(bytes + i*(BITS/8)); \
+	} \
+} \
+\
+static void pack_##BITS(const unsigned * restrict samples, unsigned char * restrict bytes, \
+							int count) \
+{ \
+	int i; \
+	for(i=0; i<count; i++) \
+	{ \
+		STORE_##BITS(bytes + i*(BITS/8), samples[i]); \
+	} \
+}
+
+DEFINE_BIT_SIZE(8)
+DEFINE_BIT_SIZE(16)
+DEFINE_BIT_SIZE(32)
+
+/*
+ * The channel kernels for MONO.
+ */
+static void split_mono(const unsigned *samples, unsigned *left, unsigned *right, int frames)
+{
+	memcpy(left, samples, frames * sizeof(unsigned));
+}
+
+static void to_stereo_mono(const unsigned * restrict samples, unsigned * restrict out,
+							int frames)
+{
+	int i;
+	for(i=0; i<frames; i++)
+	{
+		out[2*i] = samples[i];
+		out[2*i+1] = samples[i];
+	}
+}
+
+static void to_mono_mono(const unsigned *samples, unsigned *out, int frames)
+{
+	memcpy(out, samples, frames * sizeof(unsigned));
+}
+
+/*
+ * The channel kernels for STEREO.
+ */
+static void split_stereo(const unsigned * restrict samples, unsigned * restrict left,
+							unsigned * restrict right, int frames)
+{
+	int i;
+	for(i=0; i<frames; i++)
+	{
+		left[i] = samples[2*i];
+		right[i] = samples[2*i+1];
+	}
+}
+
+static void to_stereo_stereo(const unsigned *samples, unsigned *out, int frames)
+{
+	memcpy(out, samples, 2 * frames * sizeof(unsigned));
+}
+
+/*The sum is done as an unsigned and halved as an int, which is what combine has always done
+(it only makes a difference for 32 bit samples that overflow)*/
+static void to_mono_stereo(const unsigned * restrict samples, unsigned * restrict out,
+							int frames)
+{
+	int i;
+	for(i=0; i<frames; i++)
+	{
+		out[i] = (int)(samples[2*i] + samples[2*i+1])/2;
+	}
+}
+
+#define MONO_CODEC(BITS) \
+	{BITS, 1, BITS/8, unpack_##BITS, pack_##BITS, split_mono, to_stereo_mono, to_mono_mono}
+#define STEREO_CODEC(BITS) \
+	{BITS, 2, BITS/8, unpack_##BITS, pack_##BITS, split_stereo, to_stereo_stereo, \
+		to_mono_stereo}
+
+static const SampleCodec codecs[3][2] =
+{
+	{MONO_CODEC(8), STEREO_CODEC(8)},
+	{MONO_CODEC(16), STEREO_CODEC(16)},
+	{MONO_CODEC(32), STEREO_CODEC(32)}
+};
+
+/**
+ * Returns the codec for a format, or NULL if the bit size isn't 8, 16 or 32.
+ */
+const SampleCodec *codec_get(int bit_size, int mono_or_stereo)
+{
+	int layout = (mono_or_stereo == STEREO) ? 1 : 0;
+
+	if(bit_size == 8)
+	{
+		return &codecs[0][layout];
+	}
+	else if(bit_size == 16)
+	{
+		return &codecs[1][layout];
+	}
+	else if(bit_size == 32)
+	{
+		return &codecs[2][layout];
+	}
+	return NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef CODEC_LIB_H_
+#define CODEC_LIB_H_
+
+typedef struct sample_codec *SampleCodecPtr;
+
+/**
+ * The block kernels for one sample format, that is one bit size and channel layout.  There is
+ * one of these for each of the six formats, all made from the same code with the format fixed
+ * at compile time, so none of the loops check the format and the compiler can vectorize them.
+ * A program looks up the codec once for each stream with codec_get and then calls through it
+ * for every block.  A frame is one sample for MONO and a pair of samples for STEREO.
+ */
+typedef struct sample_codec
+{
+	int bit_size;
+	int channels;
+	int bytes_per_sample;
+
+	/*Unpacks "count" little endian samples from "bytes".  The arrays can't overlap.*/
+	void (*unpack)(const unsigned char *bytes, unsigned *samples, int count);
+
+	/*Packs "count" samples into little endian bytes.  The arrays can't overlap.*/
+	void (*pack)(const unsigned *samples, unsigned char *bytes, int count);
+
+	/*Splits "frames" frames into one array per channel.  MONO is just copied into "left".*/
+	void (*split_channels)(const unsigned *samples, unsigned *left, unsigned *right, int frames);
+
+	/*Makes "frames" STEREO frames, MONO samples are used for both channels*/
+	void (*to_stereo)(const unsigned *samples, unsigned *out, int frames);
+
+	/*Makes "frames" MONO samples, the channels of STEREO frames are averaged the way combine
+	always has*/
+	void (*to_mono)(const unsigned *samples, unsigned *out, int frames);
+} SampleCodec;
+
+/**
+ * Returns the codec for a format, or NULL if the bit size isn't 8, 16 or 32.  "mono_or_stereo"
+ * is MONO or STEREO from util.h.
+ */
+const SampleCodec *codec_get(int bit_size, int mono_or_stereo);
+
+#endif
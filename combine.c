@@ -1,4 +1,5 @@
 #include "input_lib.h"
+#include "perf_lib.h"
 
 /**
  * Part C: Combine
@@ -13,6 +14,8 @@
  {
  	int ret_val;
  	
+ 	perf_init(&argc, argv);
+ 	
  	/*The "handle_input" function does all the real processing.*/
  	ret_val = handle_input(stdin, NULL, COMBINE);
  	
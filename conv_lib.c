@@ -0,0 +1,193 @@
+#include "conv_lib.h"
+#include "perf_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double** alloc_channels(int channels, int size);
+static void free_channels(double **arrays, int channels);
+
+/**
+ * Creates a convolver for the impulse response "ir", which holds ir_len frames of ir_channels
+ * interleaved channels.  ir_channels must be 1 or the same as channels.  block must be a power
+ * of two.  Returns NULL and prints to stderr on an error.
+ */
+ConvolverPtr convolver_create(const double *ir, int ir_len, int ir_channels, int channels,
+								int block)
+{
+	ConvolverPtr cv;
+	FftPlanPtr plan;
+	int c, p, j, frame;
+	double *spec_re, *spec_im;
+
+	if(ir_channels != 1 && ir_channels != channels)
+	{
+		fprintf(stderr, "The impulse response must be MONO or match the input channels.\n");
+		return NULL;
+	}
+	if(ir_len < 1)
+	{
+		fprintf(stderr, "The impulse response must have at least one sample.\n");
+		return NULL;
+	}
+	if((plan = fft_plan_create(2*block)) == NULL)
+	{
+		return NULL;
+	}
+
+	cv = (ConvolverPtr)perf_malloc(sizeof(Convolver));
+	cv->block = block;
+	cv->fft_size = 2*block;
+	cv->bins = block + 1;
+	cv->partitions = (ir_len + block - 1) / block;
+	cv->channels = channels;
+	cv->ir_channels = ir_channels;
+	cv->plan = plan;
+	cv->fdl_pos = 0;
+
+	cv->ir_re = alloc_channels(ir_channels, cv->partitions * cv->bins);
+	cv->ir_im = alloc_channels(ir_channels, cv->partitions * cv->bins);
+	cv->fdl_re = alloc_channels(channels, cv->partitions * cv->bins);
+	cv->fdl_im = alloc_channels(channels, cv->partitions * cv->bins);
+	cv->input = alloc_channels(channels, cv->fft_size);
+	cv->work_re = (double*)perf_malloc(cv->fft_size * sizeof(double));
+	cv->work_im = (double*)perf_malloc(cv->fft_size * sizeof(double));
+
+	/*Transform each partition of the response, zero padded to the fft size.  The 1/n of the
+	inverse transform is folded in here so it doesn't have to be done per block.*/
+	for(c=0; c<ir_channels; c++)
+	{
+		for(p=0; p<cv->partitions; p++)
+		{
+			memset(cv->work_re, 0, cv->fft_size * sizeof(double));
+			memset(cv->work_im, 0, cv->fft_size * sizeof(double));
+			for(j=0; j<block; j++)
+			{
+				frame = p*block + j;
+				if(frame < ir_len)
+				{
+					cv->work_re[j] = ir[frame*ir_channels + c] / cv->fft_size;
+				}
+			}
+			fft(plan, cv->work_re, cv->work_im, 0);
+
+			spec_re = cv->ir_re[c] + p*cv->bins;
+			spec_im = cv->ir_im[c] + p*cv->bins;
+			memcpy(spec_re, cv->work_re, cv->bins * sizeof(double));
+			memcpy(spec_im, cv->work_im, cv->bins * sizeof(double));
+		}
+	}
+	return cv;
+}
+
+/**
+ * Frees the convolver.
+ */
+void convolver_destroy(ConvolverPtr cv)
+{
+	free_channels(cv->ir_re, cv->ir_channels);
+	free_channels(cv->ir_im, cv->ir_channels);
+	free_channels(cv->fdl_re, cv->channels);
+	free_channels(cv->fdl_im, cv->channels);
+	free_channels(cv->input, cv->channels);
+	free(cv->work_re);
+	free(cv->work_im);
+	fft_plan_destroy(cv->plan);
+	free(cv);
+}
+
+/**
+ * Convolves one block of interleaved input with the impulse response.  Both "in" and "out"
+ * hold block frames.
+ */
+void convolver_process(ConvolverPtr cv, const double *in, double *out)
+{
+	int block = cv->block;
+	int bins = cv->bins;
+	int n = cv->fft_size;
+	int c, p, k, slot;
+	double *x_re, *x_im, *h_re, *h_im;
+	double *acc_re = cv->work_re;
+	double *acc_im = cv->work_im;
+	double *buf, *spec_re, *spec_im;
+
+	/*The newest spectrum goes in the next slot, overwriting the oldest one*/
+	cv->fdl_pos = (cv->fdl_pos + 1) % cv->partitions;
+
+	for(c=0; c<cv->channels; c++)
+	{
+		/*Slide the input along by a block (this is the "save" half of overlap-save)*/
+		buf = cv->input[c];
+		memmove(buf, buf + block, block * sizeof(double));
+		for(k=0; k<block; k++)
+		{
+			buf[block + k] = in[k*cv->channels + c];
+		}
+
+		spec_re = cv->fdl_re[c] + cv->fdl_pos*bins;
+		spec_im = cv->fdl_im[c] + cv->fdl_pos*bins;
+		memcpy(cv->work_re, buf, n * sizeof(double));
+		memset(cv->work_im, 0, n * sizeof(double));
+		fft(cv->plan, cv->work_re, cv->work_im, 0);
+		memcpy(spec_re, cv->work_re, bins * sizeof(double));
+		memcpy(spec_im, cv->work_im, bins * sizeof(double));
+
+		/*Multiply each past input spectrum by the matching partition and add them up*/
+		memset(acc_re, 0, bins * sizeof(double));
+		memset(acc_im, 0, bins * sizeof(double));
+		for(p=0; p<cv->partitions; p++)
+		{
+			slot = (cv->fdl_pos - p + cv->partitions) % cv->partitions;
+			x_re = cv->fdl_re[c] + slot*bins;
+			x_im = cv->fdl_im[c] + slot*bins;
+			h_re = cv->ir_re[cv->ir_channels == 1 ? 0 : c] + p*bins;
+			h_im = cv->ir_im[cv->ir_channels == 1 ? 0 : c] + p*bins;
+			for(k=0; k<bins; k++)
+			{
+				acc_re[k] += x_re[k]*h_re[k] - x_im[k]*h_im[k];
+				acc_im[k] += x_re[k]*h_im[k] + x_im[k]*h_re[k];
+			}
+		}
+
+		/*The input was real, so the upper half of the spectrum is the conjugate of the lower*/
+		for(k=1; k<n/2; k++)
+		{
+			acc_re[n-k] = acc_re[k];
+			acc_im[n-k] = -acc_im[k];
+		}
+		fft(cv->plan, acc_re, acc_im, 1);
+
+		/*Only the second half is free of wrap around*/
+		for(k=0; k<block; k++)
+		{
+			out[k*cv->channels + c] = acc_re[block + k];
+		}
+	}
+}
+
+/**
+ * Allocates one zeroed array of "size" doubles for each channel.
+ */
+static double** alloc_channels(int channels, int size)
+{
+	double **arrays = (double**)perf_malloc(channels * sizeof(double*));
+	int c;
+	for(c=0; c<channels; c++)
+	{
+		arrays[c] = (double*)perf_calloc(size, sizeof(double));
+	}
+	return arrays;
+}
+
+/**
+ * Frees arrays made with alloc_channels.
+ */
+static void free_channels(double **arrays, int channels)
+{
+	int c;
+	for(c=0; c<channels; c++)
+	{
+		free(arrays[c]);
+	}
+	free(arrays);
+}
@@ -0,0 +1,55 @@
+#ifndef CONV_LIB_H_
+#define CONV_LIB_H_
+
+#include "fourier.h"
+
+typedef struct convolver *ConvolverPtr;
+
+/**
+ * State for uniformly partitioned overlap-save convolution.  The impulse response is cut into
+ * partitions the size of one block, and each one is transformed once up front.  Every block of
+ * input is transformed once, kept in a ring of past spectra (the frequency domain delay line),
+ * and multiplied against all the partitions.  Latency is one block no matter how long the
+ * impulse response is.
+ */
+typedef struct convolver
+{
+	int block;			/*Frames per block*/
+	int fft_size;		/*2 * block*/
+	int bins;			/*fft_size/2 + 1, the rest are conjugates*/
+	int partitions;
+	int channels;
+	int ir_channels;	/*1 to use the same response for every channel*/
+	FftPlanPtr plan;
+
+	double **ir_re;		/*Per ir channel: partitions * bins spectra*/
+	double **ir_im;
+	double **fdl_re;	/*Per channel: partitions * bins past input spectra*/
+	double **fdl_im;
+	int fdl_pos;		/*Partition slot holding the newest spectrum*/
+	double **input;		/*Per channel: the last fft_size input samples*/
+
+	double *work_re;	/*fft_size scratch arrays*/
+	double *work_im;
+} Convolver;
+
+/**
+ * Creates a convolver for the impulse response "ir", which holds ir_len frames of ir_channels
+ * interleaved channels.  ir_channels must be 1 or the same as channels.  block must be a power
+ * of two.  Returns NULL and prints to stderr on an error.
+ */
+ConvolverPtr convolver_create(const double *ir, int ir_len, int ir_channels, int channels,
+								int block);
+
+/**
+ * Frees the convolver.
+ */
+void convolver_destroy(ConvolverPtr cv);
+
+/**
+ * Convolves one block of interleaved input with the impulse response.  Both "in" and "out"
+ * hold block frames.
+ */
+void convolver_process(ConvolverPtr cv, const double *in, double *out);
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "input_lib.h"
+#include "conv_lib.h"
+#include "resample_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include "probes.h"
+
+/*Frames per block, which is also the latency*/
+#define CONV_BLOCK 1024
+
+double* load_response(const char *file_name, int sample_rate, int *ir_len, int *ir_channels);
+
+/**
+ * Convolution Reverb
+ * This program reads a sound sample file from standard input and convolves it with the impulse
+ * response stored in another sample file.  The impulse response can be many seconds long, it
+ * is applied with partitioned fft convolution so the cost per block stays low.  The wet percent
+ * controls how much of the output is the reverb and how much is the original sound.
+ *
+ * The samples are written from 0 up, so the input's own DC level is followed and taken off
+ * before it is convolved, the same as the impulse response's is, and added back afterwards.
+ * The reverb then works on the sound itself wherever it sits in the range, and with a wet
+ * percent of 0 the output is the same as the input.
+ *
+ * Command Line Variables: convreverb <impulse response file> [wet percent]
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	FileInfoPtr file_info;
+	ConvolverPtr cv;
+	double *ir, *in, *out, *level;
+	unsigned *samples;
+	DcTracker dc;
+	int ir_len, ir_channels, channels, err_no;
+	int wet_percent = 100;
+	int samples_read, i;
+	unsigned num_samples = 0;
+	double dry, wet;
+	unsigned long long perf_start;
+
+	perf_init(&argc, argv);
+	
+	if(argc != 2 && argc != 3)
+	{
+		fprintf(stderr, "You must specify the impulse response file and optionally the wet percent.\n");
+		return 1;
+	}
+	if(argc == 3)
+	{
+		wet_percent = atoi(argv[2]);
+		if(wet_percent < 0 || wet_percent > 100)
+		{
+			fprintf(stderr, "The wet percent must be between 0 and 100.\n");
+			return 1;
+		}
+	}
+
+	file_info = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
+	/*Parse the header and pass it through to the output*/
+	if((err_no = parse_header(stdin, file_info, REVERB)) != 0)
+	{
+		free(file_info);
+		return err_no;
+	}
+	channels = (file_info->mono_or_stereo == STEREO) ? 2 : 1;
+
+	if((ir = load_response(argv[1], file_info->frequency, &ir_len, &ir_channels)) == NULL)
+	{
+		free(file_info);
+		return 1;
+	}
+	cv = convolver_create(ir, ir_len, ir_channels, channels, CONV_BLOCK);
+	free(ir);
+	if(cv == NULL)
+	{
+		free(file_info);
+		return 1;
+	}
+
+	dc_init(&dc, file_info->frequency, channels);
+	wet = wet_percent / 100.0;
+	dry = 1.0 - wet;
+
+	samples = (unsigned*)perf_malloc(CONV_BLOCK * channels * sizeof(unsigned));
+	in = (double*)perf_malloc(CONV_BLOCK * channels * sizeof(double));
+	out = (double*)perf_malloc(CONV_BLOCK * channels * sizeof(double));
+	level = (double*)perf_malloc(CONV_BLOCK * channels * sizeof(double));
+	while((samples_read = read_samples(stdin, file_info->bit_size, samples,
+											CONV_BLOCK * channels)) > 0)
+	{
+		/*A short last block is padded with silence*/
+		dc_split(&dc, samples, in, level, samples_read);
+		for(i=samples_read; i<CONV_BLOCK * channels; i++)
+		{
+			in[i] = 0.0;
+		}
+		PERF_START(perf_start);
+		convolver_process(cv, in, out);
+		PERF_STOP(PERF_COMPUTE_NS, "convolve", perf_start);
+		SOUND_PROBE1(reverb_block, samples_read);
+		perf_add(PERF_SAMPLES_PROCESSED, samples_read);
+		for(i=0; i<samples_read; i++)
+		{
+			out[i] = level[i] + dry*in[i] + wet*out[i];
+		}
+		double_to_samples(out, samples, samples_read, file_info->bit_size);
+		output_samples(stdout, samples, samples_read, file_info->bit_size);
+		num_samples += samples_read;
+	}
+
+	/*Check the amount of data against the header, as in reverb*/
+	err_no = 0;
+	if(file_info->mono_or_stereo == STEREO && num_samples % 2 != 0)
+	{
+		fprintf(stderr, "Stereo files must have an even number of samples");
+		err_no = 1;
+	}
+	num_samples = num_samples / channels;
+	if(err_no == 0 && file_info->num_samples != 0 && num_samples != file_info->num_samples)
+	{
+		fprintf(stderr, "The number of samples in the file does not match the value in the header.");
+		fprintf(stderr, "Header: %d\nFile: %d",
+					file_info->num_samples, num_samples);
+		err_no = 1;
+	}
+
+	free(samples);
+	free(in);
+	free(out);
+	free(level);
+	convolver_destroy(cv);
+	free(file_info);
+	return err_no;
+}
+
+/**
+ * Loads the impulse response from a sample file.  It is resampled if it isn't at the same rate
+ * as the input.  Any DC offset is removed and it is scaled to have an energy of 1, so the reverb
+ * has about the same loudness as the input.  Returns a malloc'ed array of interleaved values, or
+ * NULL if there's a problem with the file.
+ */
+double* load_response(const char *file_name, int sample_rate, int *ir_len, int *ir_channels)
+{
+	FILE *ir_file;
+	FileInfoPtr ir_info;
+	unsigned *raw;
+	float *in_float, *out_float;
+	double *ir;
+	double mean, energy;
+	int count, i, len;
+	ResamplerPtr rs;
+
+	if((ir_file = fopen(file_name, "r")) == NULL)
+	{
+		fprintf(stderr, "Cannot open: %s\n", file_name);
+		return NULL;
+	}
+	ir_info = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
+	raw = load_samples(ir_file, ir_info);
+	fclose(ir_file);
+	if(raw == NULL)
+	{
+		free(ir_info);
+		return NULL;
+	}
+	*ir_channels = (ir_info->mono_or_stereo == STEREO) ? 2 : 1;
+	len = ir_info->num_samples;
+	count = len * (*ir_channels);
+
+	in_float = (float*)perf_malloc((count > 0 ? count : 1) * sizeof(float));
+	samples_to_float(raw, in_float, count);
+	free(raw);
+
+	/*Bring the response to the rate of the input*/
+	if(ir_info->frequency != sample_rate && len > 0)
+	{
+		if((rs = resampler_create(ir_info->frequency, sample_rate, *ir_channels)) == NULL)
+		{
+			free(in_float);
+			free(ir_info);
+			return NULL;
+		}
+		out_float = (float*)perf_malloc((resampled_length(len, ir_info->frequency, sample_rate) +
+								rs->bank->taps + 2) * (*ir_channels) * sizeof(float));
+		len = resampler_process(rs, in_float, len, out_float);
+		len += resampler_flush(rs, out_float + len * (*ir_channels));
+		resampler_destroy(rs);
+		free(in_float);
+		in_float = out_float;
+		count = len * (*ir_channels);
+	}
+	free(ir_info);
+
+	ir = (double*)perf_malloc((count > 0 ? count : 1) * sizeof(double));
+	mean = 0.0;
+	for(i=0; i<count; i++)
+	{
+		mean += in_float[i];
+	}
+	mean = (count > 0) ? mean / count : 0.0;
+	energy = 0.0;
+	for(i=0; i<count; i++)
+	{
+		ir[i] = in_float[i] - mean;
+		energy += ir[i] * ir[i];
+	}
+	free(in_float);
+
+	if(energy == 0.0)
+	{
+		fprintf(stderr, "The impulse response is silent.\n");
+		free(ir);
+		return NULL;
+	}
+	energy = sqrt(energy / (*ir_channels));
+	for(i=0; i<count; i++)
+	{
+		ir[i] = ir[i] / energy;
+	}
+	*ir_len = len;
+	return ir;
+}
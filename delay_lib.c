@@ -0,0 +1,113 @@
+#include "delay_lib.h"
+#include "perf_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Creates a delay line with the given taps.  Returns NULL and prints to stderr if any of the
+ * taps aren't legal.
+ */
+DelayLinePtr delay_create(const DelayTap *taps, int num_taps, int channels)
+{
+	DelayLinePtr dl;
+	int i;
+	int max_delay = 0;
+	int min_delay = 0;
+	unsigned size;
+
+	for(i=0; i<num_taps; i++)
+	{
+		if(taps[i].delay < 1)
+		{
+			fprintf(stderr, "Each delay must be at least one sample long.\n");
+			return NULL;
+		}
+		if(taps[i].percent > 100)
+		{
+			fprintf(stderr, "Each percent parameter input must be between 0 and 100.\n");
+			return NULL;
+		}
+		if(taps[i].delay > max_delay)
+		{
+			max_delay = taps[i].delay;
+		}
+		if(min_delay == 0 || taps[i].delay < min_delay)
+		{
+			min_delay = taps[i].delay;
+		}
+	}
+
+	/*The ring has to hold the longest delay plus the block being worked on*/
+	size = 1;
+	while(size < (unsigned)(max_delay + DELAY_BLOCK))
+	{
+		size = size << 1;
+	}
+	size = size * channels;
+
+	dl = (DelayLinePtr)perf_malloc(sizeof(DelayLine));
+	dl->ring = (unsigned*)perf_calloc(size, sizeof(unsigned));
+	dl->mask = size - 1;
+	dl->pos = 0;
+	dl->channels = channels;
+	dl->min_delay = (min_delay == 0) ? DELAY_BLOCK : min_delay;
+	dl->num_taps = num_taps;
+	dl->taps = (DelayTap*)perf_malloc((num_taps > 0 ? num_taps : 1) * sizeof(DelayTap));
+	memcpy(dl->taps, taps, num_taps * sizeof(DelayTap));
+	return dl;
+}
+
+/**
+ * Frees the delay line.
+ */
+void delay_destroy(DelayLinePtr dl)
+{
+	free(dl->ring);
+	free(dl->taps);
+	free(dl);
+}
+
+/**
+ * Adds the echoes to a block of interleaved samples in place.  Every output sample is the
+ * input plus percent/100 of the output "delay" frames earlier, for each tap.  This matches the
+ * integer math of the original queue, so the results are the same.
+ */
+void delay_process(DelayLinePtr dl, unsigned *samples, int frames)
+{
+	unsigned *ring = dl->ring;
+	unsigned mask = dl->mask;
+	unsigned read_pos;
+	unsigned percent;
+	int done, chunk, count, t, i;
+
+	/*Work in pieces no longer than the shortest delay, so every echo comes from output that
+	is already in the ring*/
+	for(done=0; done<frames; done+=chunk)
+	{
+		unsigned *block;
+		chunk = frames - done;
+		if(chunk > dl->min_delay)
+		{
+			chunk = dl->min_delay;
+		}
+		block = samples + done*dl->channels;
+		count = chunk * dl->channels;
+
+		for(t=0; t<dl->num_taps; t++)
+		{
+			read_pos = dl->pos - dl->taps[t].delay * dl->channels;
+			percent = dl->taps[t].percent;
+			for(i=0; i<count; i++)
+			{
+				block[i] += (ring[(read_pos + i) & mask] * percent) / 100;
+			}
+		}
+
+		for(i=0; i<count; i++)
+		{
+			ring[(dl->pos + i) & mask] = block[i];
+		}
+		dl->pos = (dl->pos + count) & mask;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef DELAY_LIB_H_
+#define DELAY_LIB_H_
+
+/*Number of frames processed at a time by the reverb program*/
+#define DELAY_BLOCK 1024
+
+/**
+ * One echo of the delay line.  The delay is in frames (one sample per channel), and the
+ * attenuation is a percent from 0 to 100.
+ */
+typedef struct delay_tap
+{
+	int delay;
+	unsigned percent;
+} DelayTap;
+
+typedef struct delay_line *DelayLinePtr;
+
+/**
+ * A multi-tap echo on a ring buffer.  The size of the ring is a power of two so the read and
+ * write positions wrap with a mask instead of a branch.  Samples are stored interleaved, so
+ * a stereo stream keeps its channels together and delays don't have to be doubled.
+ */
+typedef struct delay_line
+{
+	unsigned *ring;
+	unsigned mask;		/*Ring size in samples - 1*/
+	unsigned pos;		/*Where the next output sample will be written*/
+	int channels;
+	int min_delay;		/*Shortest delay in frames, the most we can process at once*/
+	int num_taps;
+	DelayTap *taps;
+} DelayLine;
+
+/**
+ * Creates a delay line with the given taps.  Returns NULL and prints to stderr if any of the
+ * taps aren't legal.
+ */
+DelayLinePtr delay_create(const DelayTap *taps, int num_taps, int channels);
+
+/**
+ * Frees the delay line.
+ */
+void delay_destroy(DelayLinePtr dl);
+
+/**
+ * Adds the echoes to a block of interleaved samples in place.  Every output sample is the
+ * input plus percent/100 of the output "delay" frames earlier, for each tap.  This matches the
+ * integer math of the original queue, so the results are the same.
+ */
+void delay_process(DelayLinePtr dl, unsigned *samples, int frames);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef DTMF_LIB_H_
+#define DTMF_LIB_H_
+
+#include <stdio.h>
+
+/**
+ * Reads a sound file from "inp" and writes the sequence of dtmf buttons pushed to generate it
+ * to "out", each one followed by a space, and then a newline.  If "pipelined" is set the
+ * samples are read on their own thread and passed over a window at a time through a ring.
+ * Returns 0 on success and 1 on failure (error written to stderr).
+ */
+int dtmf_decode(FILE *inp, FILE *out, int pipelined);
+
+#endif
@@ -0,0 +1,498 @@
+#include "envelope_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+/*Frames read from the file at a time while building*/
+#define BUILD_BLOCK (16 * ENVELOPE_BASE)
+#define ENVELOPE_MAGIC "WIDX"
+#define ENVELOPE_VERSION 1
+
+/**
+ * The start of a saved index.  The size and modification time of the sound file are kept so
+ * an index for an older version of the file isn't used.  The levels follow, each one as its
+ * size and number of buckets and then its three arrays.
+ */
+typedef struct envelope_file_header
+{
+	char magic[4];
+	int version;
+	long long source_size;
+	long long source_mtime;
+	long data_offset;
+	unsigned frames;
+	int mono_or_stereo;
+	int frequency;
+	int bit_size;
+	int num_levels;
+} EnvelopeFileHeader;
+
+static char* index_file_name(const char *file_name);
+static void build_levels(WaveIndexPtr index);
+static void alloc_level(EnvelopeLevel *level, unsigned size, unsigned num_buckets);
+static int get_raw(WaveIndexPtr index, unsigned start, unsigned end, int width,
+					double *min_out, double *max_out, double *rms_out);
+
+/**
+ * Reads the whole file and builds its index.  Only whole frames are indexed.  Returns NULL if
+ * the file can't be read or isn't a valid sound file.
+ */
+WaveIndexPtr envelope_build(const char *file_name)
+{
+	FILE *inp;
+	struct stat source;
+	WaveIndexPtr index;
+	EnvelopeLevel *base;
+	unsigned samples[BUILD_BLOCK * 2];
+	unsigned capacity = 1024;
+	unsigned mid, v, frame_in_bucket, b;
+	int count, frames, i, c;
+	double dist;
+
+	if((inp = fopen(file_name, "r")) == NULL)
+	{
+		fprintf(stderr, "Cannot open: %s\n", file_name);
+		return NULL;
+	}
+	index = (WaveIndexPtr)perf_malloc(sizeof(WaveIndex));
+	if(parse_header(inp, &index->info, NONE) != 0)
+	{
+		fclose(inp);
+		free(index);
+		return NULL;
+	}
+	/*Taken before reading, so a change made while it's being read makes the index stale*/
+	fstat(fileno(inp), &source);
+	index->source_size = source.st_size;
+	index->source_mtime = source.st_mtime;
+	index->file_name = strdup(file_name);
+	index->data_offset = ftell(inp);
+	index->channels = (index->info.mono_or_stereo == STEREO) ? 2 : 1;
+	index->frames = 0;
+	mid = 1u << (index->info.bit_size - 1);
+
+	base = &index->levels[0];
+	alloc_level(base, ENVELOPE_BASE, capacity);
+	b = 0;
+	frame_in_bucket = 0;
+	while((count = read_samples(inp, index->info.bit_size, samples,
+								BUILD_BLOCK * index->channels)) > 0)
+	{
+		frames = count / index->channels;
+		for(i=0; i<frames; i++)
+		{
+			if(frame_in_bucket == 0)
+			{
+				if(b == capacity)
+				{
+					capacity = capacity * 2;
+					base->min = (unsigned*)perf_realloc(base->min, capacity * sizeof(unsigned));
+					base->max = (unsigned*)perf_realloc(base->max, capacity * sizeof(unsigned));
+					base->sum_squares = (double*)perf_realloc(base->sum_squares,
+															capacity * sizeof(double));
+				}
+				base->min[b] = 0xFFFFFFFFu;
+				base->max[b] = 0;
+				base->sum_squares[b] = 0.0;
+			}
+			for(c=0; c<index->channels; c++)
+			{
+				v = samples[i*index->channels + c];
+				base->min[b] = (v < base->min[b]) ? v : base->min[b];
+				base->max[b] = (v > base->max[b]) ? v : base->max[b];
+				dist = (double)v - mid;
+				base->sum_squares[b] += dist * dist;
+			}
+			frame_in_bucket++;
+			if(frame_in_bucket == ENVELOPE_BASE)
+			{
+				frame_in_bucket = 0;
+				b++;
+			}
+		}
+		index->frames += frames;
+	}
+	fclose(inp);
+
+	base->num_buckets = (frame_in_bucket > 0) ? b + 1 : b;
+	build_levels(index);
+	return index;
+}
+
+/**
+ * Makes each level above the first by combining groups of ENVELOPE_FACTOR buckets from the
+ * level below, until a level has only one bucket.
+ */
+static void build_levels(WaveIndexPtr index)
+{
+	EnvelopeLevel *below, *level;
+	unsigned b, j, first, last;
+	int l;
+
+	index->num_levels = 1;
+	for(l=1; l<ENVELOPE_MAX_LEVELS && index->levels[l-1].num_buckets > 1; l++)
+	{
+		below = &index->levels[l-1];
+		level = &index->levels[l];
+		alloc_level(level, below->size * ENVELOPE_FACTOR,
+					(below->num_buckets + ENVELOPE_FACTOR - 1) / ENVELOPE_FACTOR);
+		for(b=0; b<level->num_buckets; b++)
+		{
+			first = b * ENVELOPE_FACTOR;
+			last = first + ENVELOPE_FACTOR;
+			if(last > below->num_buckets)
+			{
+				last = below->num_buckets;
+			}
+			level->min[b] = below->min[first];
+			level->max[b] = below->max[first];
+			level->sum_squares[b] = 0.0;
+			for(j=first; j<last; j++)
+			{
+				level->min[b] = (below->min[j] < level->min[b]) ? below->min[j] : level->min[b];
+				level->max[b] = (below->max[j] > level->max[b]) ? below->max[j] : level->max[b];
+				level->sum_squares[b] += below->sum_squares[j];
+			}
+		}
+		index->num_levels++;
+	}
+}
+
+/**
+ * Allocates the arrays for a level.
+ */
+static void alloc_level(EnvelopeLevel *level, unsigned size, unsigned num_buckets)
+{
+	unsigned n = (num_buckets > 0) ? num_buckets : 1;
+
+	level->size = size;
+	level->num_buckets = num_buckets;
+	level->min = (unsigned*)perf_malloc(n * sizeof(unsigned));
+	level->max = (unsigned*)perf_malloc(n * sizeof(unsigned));
+	level->sum_squares = (double*)perf_malloc(n * sizeof(double));
+}
+
+/**
+ * Returns the malloc'ed name of the saved index for the file.
+ */
+static char* index_file_name(const char *file_name)
+{
+	char *name = (char*)perf_malloc(strlen(file_name) + strlen(ENVELOPE_SUFFIX) + 1);
+	strcpy(name, file_name);
+	strcat(name, ENVELOPE_SUFFIX);
+	return name;
+}
+
+/**
+ * Loads the index saved next to the file.  Returns NULL if there isn't one, or if the file
+ * has changed since it was saved.
+ */
+WaveIndexPtr envelope_load(const char *file_name)
+{
+	struct stat source;
+	EnvelopeFileHeader header;
+	WaveIndexPtr index;
+	EnvelopeLevel *level;
+	char *name;
+	FILE *inp;
+	int l, ok = 1;
+
+	if(stat(file_name, &source) != 0)
+	{
+		return NULL;
+	}
+	name = index_file_name(file_name);
+	inp = fopen(name, "rb");
+	free(name);
+	if(inp == NULL)
+	{
+		return NULL;
+	}
+	if(fread(&header, sizeof(header), 1, inp) != 1 ||
+			memcmp(header.magic, ENVELOPE_MAGIC, 4) != 0 ||
+			header.version != ENVELOPE_VERSION ||
+			header.source_size != (long long)source.st_size ||
+			header.source_mtime != (long long)source.st_mtime ||
+			header.num_levels < 1 || header.num_levels > ENVELOPE_MAX_LEVELS)
+	{
+		fclose(inp);
+		return NULL;
+	}
+
+	index = (WaveIndexPtr)perf_malloc(sizeof(WaveIndex));
+	index->file_name = strdup(file_name);
+	index->source_size = header.source_size;
+	index->source_mtime = header.source_mtime;
+	index->data_offset = header.data_offset;
+	index->frames = header.frames;
+	index->info.mono_or_stereo = header.mono_or_stereo;
+	index->info.frequency = header.frequency;
+	index->info.bit_size = header.bit_size;
+	index->info.num_samples = header.frames;
+	index->info.header_stats = 0;
+	index->channels = (header.mono_or_stereo == STEREO) ? 2 : 1;
+	index->num_levels = 0;
+	for(l=0; l<header.num_levels && ok; l++)
+	{
+		level = &index->levels[l];
+		if(fread(&level->size, sizeof(unsigned), 1, inp) != 1 ||
+				fread(&level->num_buckets, sizeof(unsigned), 1, inp) != 1)
+		{
+			ok = 0;
+			break;
+		}
+		alloc_level(level, level->size, level->num_buckets);
+		index->num_levels++;
+		ok = (fread(level->min, sizeof(unsigned), level->num_buckets, inp) ==
+										level->num_buckets &&
+				fread(level->max, sizeof(unsigned), level->num_buckets, inp) ==
+										level->num_buckets &&
+				fread(level->sum_squares, sizeof(double), level->num_buckets, inp) ==
+										level->num_buckets);
+	}
+	fclose(inp);
+
+	if(!ok)
+	{
+		envelope_destroy(index);
+		return NULL;
+	}
+	return index;
+}
+
+/**
+ * Saves the index next to its file so it doesn't have to be built again.  Returns 0 on
+ * success and 1 if it couldn't be written.
+ */
+int envelope_save(WaveIndexPtr index)
+{
+	EnvelopeFileHeader header;
+	EnvelopeLevel *level;
+	char *name;
+	FILE *out;
+	int l;
+
+	name = index_file_name(index->file_name);
+	out = fopen(name, "wb");
+	if(out == NULL)
+	{
+		free(name);
+		return 1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ENVELOPE_MAGIC, 4);
+	header.version = ENVELOPE_VERSION;
+	header.source_size = index->source_size;
+	header.source_mtime = index->source_mtime;
+	header.data_offset = index->data_offset;
+	header.frames = index->frames;
+	header.mono_or_stereo = index->info.mono_or_stereo;
+	header.frequency = index->info.frequency;
+	header.bit_size = index->info.bit_size;
+	header.num_levels = index->num_levels;
+	fwrite(&header, sizeof(header), 1, out);
+	for(l=0; l<index->num_levels; l++)
+	{
+		level = &index->levels[l];
+		fwrite(&level->size, sizeof(unsigned), 1, out);
+		fwrite(&level->num_buckets, sizeof(unsigned), 1, out);
+		fwrite(level->min, sizeof(unsigned), level->num_buckets, out);
+		fwrite(level->max, sizeof(unsigned), level->num_buckets, out);
+		fwrite(level->sum_squares, sizeof(double), level->num_buckets, out);
+	}
+
+	/*Don't leave half an index behind*/
+	if(fclose(out) != 0)
+	{
+		remove(name);
+		free(name);
+		return 1;
+	}
+	free(name);
+	return 0;
+}
+
+/**
+ * Loads the saved index for the file if there is an up to date one, otherwise builds it and
+ * tries to save it.  Returns NULL if the file isn't a valid sound file.
+ */
+WaveIndexPtr envelope_open(const char *file_name)
+{
+	WaveIndexPtr index;
+
+	if((index = envelope_load(file_name)) != NULL)
+	{
+		return index;
+	}
+	if((index = envelope_build(file_name)) != NULL)
+	{
+		/*It's only a cache, so it doesn't matter if it can't be saved*/
+		envelope_save(index);
+	}
+	return index;
+}
+
+/**
+ * Checks the file's size and modification time against the ones the index was made from.
+ */
+int envelope_current(WaveIndexPtr index)
+{
+	struct stat source;
+
+	if(stat(index->file_name, &source) != 0)
+	{
+		return 0;
+	}
+	return source.st_size == index->source_size && source.st_mtime == index->source_mtime;
+}
+
+/**
+ * Frees the index.
+ */
+void envelope_destroy(WaveIndexPtr index)
+{
+	int l;
+
+	for(l=0; l<index->num_levels; l++)
+	{
+		free(index->levels[l].min);
+		free(index->levels[l].max);
+		free(index->levels[l].sum_squares);
+	}
+	free(index->file_name);
+	free(index);
+}
+
+/**
+ * Works out the envelope of frames "start" up to "end" drawn "width" pixels wide.  When a
+ * pixel covers at least ENVELOPE_BASE frames, the level with the biggest buckets that still
+ * fit in a pixel is used, so each pixel needs at most ENVELOPE_FACTOR + 2 buckets.  Pixels are
+ * widened to the edges of the buckets they touch.  When pixels are smaller than that the
+ * frames are read from the file, which is still at most ENVELOPE_BASE frames per pixel.
+ * Returns 0 on success and 1 if the range isn't in the file.
+ */
+int envelope_get(WaveIndexPtr index, unsigned start, unsigned end, int width,
+					double *min_out, double *max_out, double *rms_out)
+{
+	EnvelopeLevel *level;
+	unsigned long long range = end - start;
+	unsigned long long first, last;
+	unsigned b, b_end, bucket_end, lo, hi;
+	double sum_squares, count;
+	int l, p;
+
+	if(width <= 0 || start >= end || end > index->frames)
+	{
+		return 1;
+	}
+	if(range < (unsigned long long)width * ENVELOPE_BASE)
+	{
+		return get_raw(index, start, end, width, min_out, max_out, rms_out);
+	}
+
+	l = 0;
+	while(l + 1 < index->num_levels &&
+			(unsigned long long)index->levels[l+1].size * width <= range)
+	{
+		l++;
+	}
+	level = &index->levels[l];
+
+	for(p=0; p<width; p++)
+	{
+		first = start + range * p / width;
+		last = start + range * (p + 1) / width;
+		b = first / level->size;
+		b_end = (last + level->size - 1) / level->size;
+		if(b_end > level->num_buckets)
+		{
+			b_end = level->num_buckets;
+		}
+
+		lo = level->min[b];
+		hi = level->max[b];
+		sum_squares = 0.0;
+		for(; b<b_end; b++)
+		{
+			lo = (level->min[b] < lo) ? level->min[b] : lo;
+			hi = (level->max[b] > hi) ? level->max[b] : hi;
+			sum_squares += level->sum_squares[b];
+		}
+		/*The last bucket in the file can be short*/
+		bucket_end = b_end * level->size;
+		if(bucket_end > index->frames)
+		{
+			bucket_end = index->frames;
+		}
+		count = (double)(bucket_end - (first / level->size) * level->size) * index->channels;
+
+		min_out[p] = lo;
+		max_out[p] = hi;
+		rms_out[p] = sqrt(sum_squares / count);
+	}
+	return 0;
+}
+
+/**
+ * Works out the envelope straight from the samples in the file, for ranges too short for the
+ * index.  If there are more pixels than frames, each pixel gets the frame it falls on.
+ */
+static int get_raw(WaveIndexPtr index, unsigned start, unsigned end, int width,
+					double *min_out, double *max_out, double *rms_out)
+{
+	FILE *inp;
+	unsigned *samples;
+	unsigned long long range = end - start;
+	unsigned long long first, last;
+	unsigned mid = 1u << (index->info.bit_size - 1);
+	unsigned count = (end - start) * index->channels;
+	unsigned lo, hi, v, i;
+	double sum_squares, dist;
+	int p, read;
+
+	if((inp = fopen(index->file_name, "r")) == NULL)
+	{
+		return 1;
+	}
+	samples = (unsigned*)perf_malloc(count * sizeof(unsigned));
+	fseek(inp, index->data_offset + (long)start * index->channels *
+								(index->info.bit_size / 8), SEEK_SET);
+	read = read_samples(inp, index->info.bit_size, samples, count);
+	fclose(inp);
+	if(read != (int)count)
+	{
+		free(samples);
+		return 1;
+	}
+
+	for(p=0; p<width; p++)
+	{
+		first = range * p / width;
+		last = range * (p + 1) / width;
+		if(last == first)
+		{
+			last = first + 1;
+		}
+		lo = 0xFFFFFFFFu;
+		hi = 0;
+		sum_squares = 0.0;
+		for(i=first * index->channels; i<last * index->channels; i++)
+		{
+			v = samples[i];
+			lo = (v < lo) ? v : lo;
+			hi = (v > hi) ? v : hi;
+			dist = (double)v - mid;
+			sum_squares += dist * dist;
+		}
+		min_out[p] = lo;
+		max_out[p] = hi;
+		rms_out[p] = sqrt(sum_squares / ((last - first) * index->channels));
+	}
+	free(samples);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef ENVELOPE_LIB_H_
+#define ENVELOPE_LIB_H_
+
+#include "input_lib.h"
+
+/*Frames covered by each bucket of the finest level*/
+#define ENVELOPE_BASE 256
+/*Each level's buckets cover this many buckets of the level below*/
+#define ENVELOPE_FACTOR 4
+#define ENVELOPE_MAX_LEVELS 16
+/*Added to the sound file's name to get the name of its saved index*/
+#define ENVELOPE_SUFFIX ".widx"
+
+/**
+ * One level of the index.  Bucket b covers frames b*size up to (b+1)*size, and holds the
+ * smallest and largest sample in those frames and the sum of the squares of their distances
+ * from the middle value.  Both channels of a stereo file go into the same buckets.
+ */
+typedef struct envelope_level
+{
+	unsigned size;			/*Frames per bucket*/
+	unsigned num_buckets;
+	unsigned *min;
+	unsigned *max;
+	double *sum_squares;
+} EnvelopeLevel;
+
+typedef struct wave_index *WaveIndexPtr;
+
+/**
+ * A min/max/RMS pyramid over a whole sound file.  Each level has ENVELOPE_FACTOR times fewer
+ * buckets than the one below it, so the envelope for any range can be put together from a
+ * handful of buckets per pixel.
+ */
+typedef struct wave_index
+{
+	char *file_name;
+	long long source_size;		/*Size and modification time of the file it was made from*/
+	long long source_mtime;
+	long data_offset;		/*Where the data starts in the file*/
+	FileInfo info;
+	unsigned frames;
+	int channels;
+	int num_levels;
+	EnvelopeLevel levels[ENVELOPE_MAX_LEVELS];
+} WaveIndex;
+
+/**
+ * Reads the whole file and builds its index.  Returns NULL if the file can't be read or isn't
+ * a valid sound file.
+ */
+WaveIndexPtr envelope_build(const char *file_name);
+
+/**
+ * Loads the index saved next to the file.  Returns NULL if there isn't one, or if the file
+ * has changed since it was saved.
+ */
+WaveIndexPtr envelope_load(const char *file_name);
+
+/**
+ * Saves the index next to its file so it doesn't have to be built again.  Returns 0 on
+ * success and 1 if it couldn't be written.
+ */
+int envelope_save(WaveIndexPtr index);
+
+/**
+ * Loads the saved index for the file if there is an up to date one, otherwise builds it and
+ * tries to save it.  Returns NULL if the file isn't a valid sound file.
+ */
+WaveIndexPtr envelope_open(const char *file_name);
+
+/**
+ * Returns 1 if the file hasn't changed since the index was made from it, and 0 if it has or
+ * can't be found any more.
+ */
+int envelope_current(WaveIndexPtr index);
+/**
+ * Frees the index.
+ */
+void envelope_destroy(WaveIndexPtr index);
+
+/**
+ * Works out the envelope of frames "start" up to "end" drawn "width" pixels wide.  For each
+ * pixel the smallest and largest sample and the RMS distance from the middle value are put in
+ * min_out, max_out and rms_out.  The time taken depends on the width, not on the number of
+ * frames.  Returns 0 on success and 1 if the range isn't in the file.
+ */
+int envelope_get(WaveIndexPtr index, unsigned start, unsigned end, int width,
+					double *min_out, double *max_out, double *rms_out);
+
+#endif
@@ -0,0 +1,157 @@
+#include "fdn_lib.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <math.h>
+
+/*Delay line lengths in milliseconds.  They are spread out and have no common factors so the
+echoes don't pile up on each other.*/
+static const double line_ms[FDN_LINES] = {29.7, 37.1, 41.1, 43.7, 53.1, 59.3, 67.1, 73.9};
+
+/*Signs used to take two different sums of the lines for the left and right outputs*/
+static const float left_sign[FDN_LINES] = {1, -1, 1, -1, 1, -1, 1, -1};
+static const float right_sign[FDN_LINES] = {1, 1, -1, -1, 1, 1, -1, -1};
+
+/**
+ * Creates the network for the given sample rate.  reverb_time is the time in seconds it takes
+ * the tail to die down by 60dB.
+ */
+FdnPtr fdn_create(int sample_rate, double reverb_time, int channels)
+{
+	FdnPtr fdn = (FdnPtr)perf_malloc(sizeof(Fdn));
+	unsigned size = 1;
+	int i;
+
+	for(i=0; i<FDN_LINES; i++)
+	{
+		fdn->length[i] = (int)(line_ms[i] * sample_rate / 1000.0);
+		if(fdn->length[i] < FDN_BLOCK)
+		{
+			fdn->length[i] = FDN_BLOCK + 2*i + 1;
+		}
+		/*-60dB after reverb_time seconds, so each trip loses its share of that*/
+		fdn->gain[i] = (float)pow(10.0, -3.0 * fdn->length[i] / (reverb_time * sample_rate));
+		fdn->lowpass[i] = 0.0f;
+		while(size < (unsigned)(fdn->length[i] + FDN_BLOCK))
+		{
+			size = size << 1;
+		}
+	}
+	for(i=0; i<FDN_LINES; i++)
+	{
+		fdn->lines[i] = (float*)perf_calloc(size, sizeof(float));
+	}
+	fdn->mask = size - 1;
+	fdn->pos = 0;
+	fdn->damping = 0.2f;
+	fdn->channels = channels;
+	return fdn;
+}
+
+/**
+ * Frees the network.
+ */
+void fdn_destroy(FdnPtr fdn)
+{
+	int i;
+	for(i=0; i<FDN_LINES; i++)
+	{
+		free(fdn->lines[i]);
+	}
+	free(fdn);
+}
+
+/**
+ * Runs one block of interleaved input through the network.  "in" and "out" hold "frames"
+ * frames, which can't be more than FDN_BLOCK.  The output is only the reverb tail; the caller
+ * mixes it with the dry sound.
+ */
+void fdn_process(FdnPtr fdn, const float *in, float *out, int frames)
+{
+	unsigned mask = fdn->mask;
+	unsigned start;
+	int i, n;
+	float damping = fdn->damping;
+	float input, left, right;
+	float v[FDN_LINES];
+	float a, b;
+
+	/*Every line is at least a block long, so the whole block of line outputs was written
+	before this block started*/
+	for(i=0; i<FDN_LINES; i++)
+	{
+		const float *line = fdn->lines[i];
+		start = fdn->pos - fdn->length[i];
+		for(n=0; n<frames; n++)
+		{
+			fdn->taps[n][i] = line[(start + n) & mask];
+		}
+	}
+
+	for(n=0; n<frames; n++)
+	{
+		float *t = fdn->taps[n];
+
+		input = in[n*fdn->channels];
+		if(fdn->channels == 2)
+		{
+			input = 0.5f * (input + in[n*2 + 1]);
+		}
+
+		left = 0.0f;
+		right = 0.0f;
+		for(i=0; i<FDN_LINES; i++)
+		{
+			left += left_sign[i] * t[i];
+			right += right_sign[i] * t[i];
+		}
+		if(fdn->channels == 2)
+		{
+			out[n*2] = left * 0.25f;
+			out[n*2 + 1] = right * 0.25f;
+		}
+		else
+		{
+			out[n] = left * 0.25f;
+		}
+
+		/*Damp the high frequencies a little on each trip*/
+		for(i=0; i<FDN_LINES; i++)
+		{
+			fdn->lowpass[i] = t[i] + damping * (fdn->lowpass[i] - t[i]);
+			v[i] = fdn->lowpass[i];
+		}
+
+		/*Fast Hadamard transform, three rounds of butterflies*/
+		for(i=0; i<FDN_LINES; i+=2)
+		{
+			a = v[i]; b = v[i+1];
+			v[i] = a + b; v[i+1] = a - b;
+		}
+		for(i=0; i<FDN_LINES; i+=4)
+		{
+			a = v[i]; b = v[i+2]; v[i] = a + b; v[i+2] = a - b;
+			a = v[i+1]; b = v[i+3]; v[i+1] = a + b; v[i+3] = a - b;
+		}
+		for(i=0; i<FDN_LINES/2; i++)
+		{
+			a = v[i]; b = v[i+4];
+			v[i] = a + b; v[i+4] = a - b;
+		}
+
+		/*1/sqrt(8) keeps the matrix lossless, then each line gets its own decay*/
+		for(i=0; i<FDN_LINES; i++)
+		{
+			t[i] = input + fdn->gain[i] * 0.35355339f * v[i];
+		}
+	}
+
+	for(i=0; i<FDN_LINES; i++)
+	{
+		float *line = fdn->lines[i];
+		for(n=0; n<frames; n++)
+		{
+			line[(fdn->pos + n) & mask] = fdn->taps[n][i];
+		}
+	}
+	fdn->pos = (fdn->pos + frames) & mask;
+}
@@ -0,0 +1,50 @@
+#ifndef FDN_LIB_H_
+#define FDN_LIB_H_
+
+/*Number of delay lines, the feedback matrix is an 8x8 Hadamard matrix*/
+#define FDN_LINES 8
+/*Frames processed per block.  Every delay line is at least this long.*/
+#define FDN_BLOCK 128
+
+typedef struct fdn *FdnPtr;
+
+/**
+ * A feedback delay network.  Each block, the outputs of all the delay lines are read, mixed
+ * together with the feedback matrix, attenuated, and written back in along with the input.
+ * The per-frame work is done on arrays of FDN_LINES floats so it can be done with vector
+ * instructions across the lines.
+ */
+typedef struct fdn
+{
+	float *lines[FDN_LINES];
+	int length[FDN_LINES];	/*Delay of each line in frames*/
+	float gain[FDN_LINES];	/*Attenuation per trip through each line*/
+	float lowpass[FDN_LINES];	/*Damping filter state*/
+	float damping;
+	unsigned mask;			/*Size of each line - 1*/
+	unsigned pos;
+	int channels;
+
+	/*Scratch for one block, frame by frame with the lines next to each other*/
+	float taps[FDN_BLOCK][FDN_LINES];
+} Fdn;
+
+/**
+ * Creates the network for the given sample rate.  reverb_time is the time in seconds it takes
+ * the tail to die down by 60dB.
+ */
+FdnPtr fdn_create(int sample_rate, double reverb_time, int channels);
+
+/**
+ * Frees the network.
+ */
+void fdn_destroy(FdnPtr fdn);
+
+/**
+ * Runs one block of interleaved input through the network.  "in" and "out" hold "frames"
+ * frames, which can't be more than FDN_BLOCK.  The output is only the reverb tail; the caller
+ * mixes it with the dry sound.
+ */
+void fdn_process(FdnPtr fdn, const float *in, float *out, int frames);
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "input_lib.h"
+#include "fdn_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include "probes.h"
+
+double elapsed_us(struct timespec *start, struct timespec *end);
+
+/**
+ * FDN Reverb
+ * This program reads a sound sample file from standard input and adds a dense reverb tail
+ * using a feedback delay network.  The input is processed in fixed size blocks.  With the -r
+ * option the time taken to process each block is written to standard error next to the
+ * amount of audio in the block (the real-time budget), followed by a summary.
+ *
+ * The samples are written from 0 up, so the input's own DC level is followed and taken off
+ * before it goes into the network, and added back afterwards; a DC level fed into the
+ * feedback would build up into a large offset.  Only the wet signal is worked out in float.
+ * The dry signal stays in double, so with a wet percent of 0 the output is the same as the
+ * input, even for 32-bit samples.
+ *
+ * Command Line Variables: fdnreverb <reverb time in ms> <wet percent> [-r]
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	FileInfoPtr file_info;
+	FdnPtr fdn;
+	unsigned *samples;
+	float *in, *out;
+	double *ac, *level, *mixed;
+	DcTracker dc;
+	int channels, err_no, i;
+	int reverb_ms, wet_percent;
+	int report = 0;
+	int samples_read, frames;
+	unsigned num_samples = 0;
+	double wet, dry;
+	double block_us, budget_us;
+	double total_us = 0.0;
+	double max_us = 0.0;
+	long num_blocks = 0;
+	long overruns = 0;
+	struct timespec start, end;
+	unsigned long long perf_start;
+
+	perf_init(&argc, argv);
+	
+	if(argc == 4 && strcmp(argv[3], "-r") == 0)
+	{
+		report = 1;
+	}
+	else if(argc != 3)
+	{
+		fprintf(stderr, "You must specify the reverb time and the wet percent.\n");
+		return 1;
+	}
+	reverb_ms = atoi(argv[1]);
+	wet_percent = atoi(argv[2]);
+	if(reverb_ms <= 0)
+	{
+		fprintf(stderr, "The reverb time must be a positive number of milliseconds.\n");
+		return 1;
+	}
+	if(wet_percent < 0 || wet_percent > 100)
+	{
+		fprintf(stderr, "The wet percent must be between 0 and 100.\n");
+		return 1;
+	}
+
+	file_info = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
+	/*Parse the header and pass it through to the output*/
+	if((err_no = parse_header(stdin, file_info, REVERB)) != 0)
+	{
+		free(file_info);
+		return err_no;
+	}
+	channels = (file_info->mono_or_stereo == STEREO) ? 2 : 1;
+
+	fdn = fdn_create(file_info->frequency, reverb_ms / 1000.0, channels);
+	dc_init(&dc, file_info->frequency, channels);
+	wet = wet_percent / 100.0;
+	dry = 1.0 - wet;
+	/*The amount of time the audio in a full block lasts*/
+	budget_us = 1000000.0 * FDN_BLOCK / file_info->frequency;
+
+	samples = (unsigned*)perf_malloc(FDN_BLOCK * channels * sizeof(unsigned));
+	in = (float*)perf_malloc(FDN_BLOCK * channels * sizeof(float));
+	out = (float*)perf_malloc(FDN_BLOCK * channels * sizeof(float));
+	ac = (double*)perf_malloc(FDN_BLOCK * channels * sizeof(double));
+	level = (double*)perf_malloc(FDN_BLOCK * channels * sizeof(double));
+	mixed = (double*)perf_malloc(FDN_BLOCK * channels * sizeof(double));
+	while((samples_read = read_samples(stdin, file_info->bit_size, samples,
+											FDN_BLOCK * channels)) > 0)
+	{
+		frames = samples_read / channels;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		dc_split(&dc, samples, ac, level, frames * channels);
+		for(i=0; i<frames * channels; i++)
+		{
+			in[i] = (float)ac[i];
+		}
+		PERF_START(perf_start);
+		fdn_process(fdn, in, out, frames);
+		PERF_STOP(PERF_COMPUTE_NS, "fdn_process", perf_start);
+		SOUND_PROBE1(reverb_block, frames * channels);
+		perf_add(PERF_SAMPLES_PROCESSED, frames * channels);
+		for(i=0; i<frames * channels; i++)
+		{
+			mixed[i] = level[i] + dry*ac[i] + wet*out[i];
+		}
+		double_to_samples(mixed, samples, frames * channels, file_info->bit_size);
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		output_samples(stdout, samples, samples_read, file_info->bit_size);
+		num_samples += samples_read;
+
+		block_us = elapsed_us(&start, &end);
+		total_us += block_us;
+		if(block_us > max_us)
+		{
+			max_us = block_us;
+		}
+		/*A short last block only has to fit in its own duration*/
+		if(block_us > budget_us * frames / FDN_BLOCK)
+		{
+			overruns++;
+		}
+		if(report)
+		{
+			fprintf(stderr, "block %ld: %.1f us of %.1f us (%.2f%%)\n", num_blocks, block_us,
+					budget_us * frames / FDN_BLOCK,
+					100.0 * block_us / (budget_us * frames / FDN_BLOCK));
+		}
+		num_blocks++;
+	}
+
+	if(report && num_blocks > 0)
+	{
+		fprintf(stderr, "blocks: %ld  mean: %.1f us  max: %.1f us  budget: %.1f us  ",
+				num_blocks, total_us / num_blocks, max_us, budget_us);
+		fprintf(stderr, "overruns: %ld  speed: %.1fx real-time\n", overruns,
+				(budget_us * num_samples / channels / FDN_BLOCK) / total_us);
+	}
+
+	err_no = 0;
+	if(file_info->mono_or_stereo == STEREO && num_samples % 2 != 0)
+	{
+		fprintf(stderr, "Stereo files must have an even number of samples");
+		err_no = 1;
+	}
+	num_samples = num_samples / channels;
+	if(err_no == 0 && file_info->num_samples != 0 && num_samples != file_info->num_samples)
+	{
+		fprintf(stderr, "The number of samples in the file does not match the value in the header.");
+		fprintf(stderr, "Header: %d\nFile: %d",
+					file_info->num_samples, num_samples);
+		err_no = 1;
+	}
+
+	free(samples);
+	free(in);
+	free(out);
+	free(ac);
+	free(level);
+	free(mixed);
+	fdn_destroy(fdn);
+	free(file_info);
+	return err_no;
+}
+
+/**
+ * Returns the number of microseconds between the two times.
+ */
+double elapsed_us(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1000000.0 +
+				(end->tv_nsec - start->tv_nsec) / 1000.0;
+}
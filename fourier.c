@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "util.h"
 #include "input_lib.h"
+#include "perf_lib.h"
 
 /**
  * Used with parts H, and I
@@ -14,18 +15,31 @@
  */
 int* get_samples(int number, int start, const char* fileName)
 {
-	unsigned value;
-	int i, end_of_file, bytes_per_sample;
-	int bytes_read = 0;
-	int* samples;
-	FileInfoPtr input_info;
+	/*Plus 1 is to create the last element which will hold the sample rate*/
+	int* samples = (int*)perf_malloc(sizeof(int)*(number + 1));
+	
+	if(fill_samples(samples, number, start, fileName) != 0)
+	{
+		free(samples);
+		return NULL;
+	}
+	return samples;
+}
+
+/**
+ * Does the work for get_samples, but puts the samples in an array the caller already has so
+ * it can be memory that Java can see.  The array must hold "number" + 1 values, since the
+ * sample rate is put in the last one.  Returns 0 on success and 1 if the file can't be opened.
+ */
+int fill_samples(int* samples, int number, int start, const char* fileName)
+{
+	int i, count;
+	unsigned long long perf_start;
+	FileInfo input_info;
 	FILE* inp_file;
 	int opened_file = 0;
 	unsigned starting_sample;
 	
-	/*Plus 1 is to create the last element which will hold the sample rate*/
-	samples = (int*)malloc(sizeof(int)*(number + 1));
-	
 	/*Get the file for input.  If the string passed is "stdin" then it's handled as standard input*/
 	if(strncmp(fileName, "stdin", 5) == 0)
 	{
@@ -37,28 +51,27 @@ int* get_samples(int number, int start, const char* fileName)
 		if(inp_file == NULL)
 		{
 			fprintf(stderr, "Could not open file %s.\n", fileName);
-			return NULL;
+			return 1;
 		}
 		opened_file = 1;
 	}
 	
 	/*Parse the header from the input*/
-	input_info = (FileInfoPtr)malloc(sizeof(FileInfo));
-	parse_header(inp_file, input_info, NONE);
+	parse_header(inp_file, &input_info, NONE);
 	
 	/*Since the starting sample is coming in as a percent, we need to know the number of samples*/
 	/*If we don't get this from the header, we need to parse the file to get it, unless number is 0*/
-	if((start != 0) && (input_info->num_samples == 0))
+	if((start != 0) && (input_info.num_samples == 0))
 	{
-		parse_file(inp_file, input_info, NONE);
-		starting_sample = (start * input_info->num_samples) / 100;
+		parse_file(inp_file, &input_info, NONE);
+		starting_sample = (start * input_info.num_samples) / 100;
 		/*Make sure there are still enough samples left in the file*/
-		if(input_info->num_samples - starting_sample < number)
+		if(input_info.num_samples - starting_sample < number)
 		{
-			starting_sample = input_info->num_samples - number;
+			starting_sample = input_info.num_samples - number;
 		}
 		rewind(inp_file);
-		parse_header(inp_file, input_info, NONE);
+		parse_header(inp_file, &input_info, NONE);
 	}
 	else
 	{
@@ -68,11 +81,11 @@ int* get_samples(int number, int start, const char* fileName)
 		}
 		else
 		{
-			starting_sample = (start * input_info->num_samples) / 100;
+			starting_sample = (start * input_info.num_samples) / 100;
 			/*Make sure there are still enough samples left in the file*/
-			if(input_info->num_samples - starting_sample < number)
+			if(input_info.num_samples - starting_sample < number)
 			{
-				starting_sample = input_info->num_samples - number;
+				starting_sample = input_info.num_samples - number;
 			}
 		}
 	}
@@ -80,36 +93,26 @@ int* get_samples(int number, int start, const char* fileName)
 	/*Make sure the info provided in the header describes a legal file for this program
 	We can't really return -1, since we are returning an array, but at least we will
 	print out an error message.*/
-	check_input(input_info);
+	check_input(&input_info);
 	
-	/*Read the number of samples into the array, or until the file ends*/
-	end_of_file = 0;
-	bytes_per_sample = input_info->bit_size / 8;
-	i=0;
-	while(end_of_file == 0)
+	/*Skip to the starting sample, using the array to hold what's skipped, and then read the
+	window in one go*/
+	PERF_START(perf_start);
+	i = 0;
+	while(i < starting_sample && number > 0)
 	{
-		if((bytes_read = read_sample(inp_file, input_info->bit_size, &value)) != 
-															bytes_per_sample)
+		count = (starting_sample - i > number) ? number : starting_sample - i;
+		if((count = read_samples(inp_file, input_info.bit_size, (unsigned*)samples, count)) == 0)
 		{
-			end_of_file = 1;
-		}
-		else
-		{
-			/*Only add to the array if we are far enough along in the file.*/
-			if(i >= starting_sample)
-			{
-				samples[i - starting_sample] = value;
-			}
-		}
-		
-		i++;
-		
-		if(i >= (number + starting_sample))
-		{
-			/*We only want to read in "number" of samples even if the input is longer*/
-			end_of_file = 1;
+			break;
 		}
+		i += count;
 	}
+	if(i == starting_sample)
+	{
+		i += read_samples(inp_file, input_info.bit_size, (unsigned*)samples, number);
+	}
+	PERF_STOP(PERF_IO_WAIT_NS, "read_window", perf_start);
 	
 	/*If i is not equal to the number of samples we wanted to read, 
 	then the file must have been shorter so we print an error*/
@@ -117,15 +120,14 @@ int* get_samples(int number, int start, const char* fileName)
 	{
 		fprintf(stderr, "The file did not contain enough samples. %d\n", i);
 	}
-	samples[number] = input_info->frequency;
+	samples[number] = input_info.frequency;
 	
 	if(opened_file == 1)
 	{
 		fclose(inp_file);
 	}
 	
-	return samples;
-
+	return 0;
 }
 
 /**
@@ -137,7 +139,7 @@ double* calc_fourier(int* samples, int window_size, int k)
 {
 	double a, b;
 	int n;
-	double* result = (double*)malloc(sizeof(double)*2);
+	double* result = (double*)perf_malloc(sizeof(double)*2);
 	
 	a=0;
 	b=0;
@@ -153,6 +155,172 @@ double* calc_fourier(int* samples, int window_size, int k)
 	return result;
 }
 
+/**
+ * Calculates the first "num_bins" values of the fourier transform of the samples at once, with
+ * the same sign as calc_fourier.  The real parts go in "re" and the imaginary parts in "im".
+ * When the window size is a power of two this is done with an fft.  Otherwise it's done the
+ * same way as calc_fourier, but with a table of the cos and sin values so they are only
+ * calculated once for all the bins.  num_bins can't be more than window_size.
+ */
+void calc_spectrum(const int *samples, int window_size, int num_bins, double *re, double *im)
+{
+	FftPlanPtr plan;
+	double *full_re, *full_im;
+	double *cos_table, *sin_table;
+	double a, b, x;
+	int n, k, m;
+	
+	if(window_size >= 2 && (window_size & (window_size-1)) == 0)
+	{
+		plan = fft_plan_create(window_size);
+		full_re = (double*)perf_malloc(window_size * sizeof(double));
+		full_im = (double*)perf_malloc(window_size * sizeof(double));
+		for(n=0; n<window_size; n++)
+		{
+			full_re[n] = (unsigned)samples[n];
+			full_im[n] = 0.0;
+		}
+		fft(plan, full_re, full_im, 0);
+		for(k=0; k<num_bins; k++)
+		{
+			re[k] = full_re[k];
+			im[k] = full_im[k];
+		}
+		free(full_re);
+		free(full_im);
+		fft_plan_destroy(plan);
+		return;
+	}
+	
+	cos_table = (double*)perf_malloc(window_size * sizeof(double));
+	sin_table = (double*)perf_malloc(window_size * sizeof(double));
+	for(m=0; m<window_size; m++)
+	{
+		cos_table[m] = cos((2.0*M_PI*m)/window_size);
+		sin_table[m] = sin((2.0*M_PI*m)/window_size);
+	}
+	for(k=0; k<num_bins; k++)
+	{
+		a = 0;
+		b = 0;
+		/*m is n*k wrapped around to stay inside the table*/
+		m = 0;
+		for(n=0; n<window_size; n++)
+		{
+			x = (unsigned)samples[n];
+			a = a + x*cos_table[m];
+			b = b + x*sin_table[m];
+			m = m + k;
+			if(m >= window_size)
+			{
+				m = m - window_size;
+			}
+		}
+		re[k] = a;
+		im[k] = b;
+	}
+	free(cos_table);
+	free(sin_table);
+}
+
+/**
+ * Creates the plan for transforms of size n.  Returns NULL if n isn't a power of two.
+ */
+FftPlanPtr fft_plan_create(int n)
+{
+	FftPlanPtr plan;
+	int i, j, bits;
+	
+	if(n < 2 || (n & (n-1)) != 0)
+	{
+		fprintf(stderr, "The fft size must be a power of two.\n");
+		return NULL;
+	}
+	
+	plan = (FftPlanPtr)perf_malloc(sizeof(FftPlan));
+	plan->n = n;
+	plan->bit_reverse = (int*)perf_malloc(n * sizeof(int));
+	plan->cos_table = (double*)perf_malloc((n/2) * sizeof(double));
+	plan->sin_table = (double*)perf_malloc((n/2) * sizeof(double));
+	
+	bits = 0;
+	while((1<<bits) < n)
+	{
+		bits++;
+	}
+	for(i=0; i<n; i++)
+	{
+		plan->bit_reverse[i] = 0;
+		for(j=0; j<bits; j++)
+		{
+			if(i & (1<<j))
+			{
+				plan->bit_reverse[i] |= 1<<(bits-1-j);
+			}
+		}
+	}
+	for(i=0; i<n/2; i++)
+	{
+		plan->cos_table[i] = cos((2.0*M_PI*i)/n);
+		plan->sin_table[i] = sin((2.0*M_PI*i)/n);
+	}
+	return plan;
+}
+
+/**
+ * Frees the plan.
+ */
+void fft_plan_destroy(FftPlanPtr plan)
+{
+	free(plan->bit_reverse);
+	free(plan->cos_table);
+	free(plan->sin_table);
+	free(plan);
+}
+
+/**
+ * Does the transform in place on the real and imaginary arrays.  The forward transform uses
+ * the same sign as calc_fourier.  The inverse transform does not divide by n.
+ */
+void fft(FftPlanPtr plan, double *re, double *im, int inverse)
+{
+	int n = plan->n;
+	int i, j, k, size, half, step;
+	double tmp, wr, wi, tr, ti;
+	double sign = inverse ? -1.0 : 1.0;
+	
+	for(i=0; i<n; i++)
+	{
+		j = plan->bit_reverse[i];
+		if(j > i)
+		{
+			tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+			tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+		}
+	}
+	
+	/*Combine the transforms in pairs, doubling the size each time*/
+	for(size=2; size<=n; size=size*2)
+	{
+		half = size/2;
+		step = n/size;
+		for(i=0; i<n; i+=size)
+		{
+			for(k=0; k<half; k++)
+			{
+				wr = plan->cos_table[k*step];
+				wi = sign * plan->sin_table[k*step];
+				j = i + k + half;
+				tr = re[j]*wr - im[j]*wi;
+				ti = re[j]*wi + im[j]*wr;
+				re[j] = re[i+k] - tr;
+				im[j] = im[i+k] - ti;
+				re[i+k] += tr;
+				im[i+k] += ti;
+			}
+		}
+	}
+}
 
 /**
  * Check that the sound sample is mono.
@@ -175,43 +343,27 @@ int check_input(FileInfoPtr file_info)
  */
 unsigned* get_samples_stdin(int number, int bit_size)
 {
-	int end_of_file;
-	int bytes_per_sample;
-	unsigned value;
+	return get_samples_file(stdin, number, bit_size);
+}
+
+/**
+ * Reads the next window of "number" samples from "inp" into a malloc'ed array with room for
+ * the sample rate at the end.  Returns NULL if the input ends first.
+ */
+unsigned* get_samples_file(FILE *inp, int number, int bit_size)
+{
 	unsigned *samples;
-	int i, bytes_read;
+	int count;
+	unsigned long long start;
 	
 	/*Plus 1 is to create the last element which will hold the sample rate*/
-	samples = (unsigned*)malloc(sizeof(int)*(number + 1));
+	samples = (unsigned*)perf_malloc(sizeof(int)*(number + 1));
 	
-	/*Read the number of samples into the buffer, or until the file ends*/
-	end_of_file = 0;
-	bytes_per_sample = bit_size / 8;
-	i=0;
-	while(end_of_file == 0)
-	{
-		if((bytes_read = read_sample(stdin, bit_size, &value)) != 
-															bytes_per_sample)
-		{
-			end_of_file = 1;
-		}
-		else
-		{
-			samples[i] = value;
-		}
-		
-		i++;
-		
-		if(i >= (number))
-		{
-			/*We only want to read in "number" of samples even if the input is longer*/
-			end_of_file = 1;
-		}
-	}
-	
-	/*If i is not equal to the number of samples we wanted to read, 
-	then the file must have been shorter so we print an error*/
-	if(i != (number))
+	/*Read the number of samples into the buffer.  If the input ends first there's no window.*/
+	PERF_START(start);
+	count = read_samples(inp, bit_size, samples, number);
+	PERF_STOP(PERF_IO_WAIT_NS, "read_window", start);
+	if(count != number)
 	{
 		free(samples);
 		return NULL;
@@ -15,11 +15,54 @@
  */
 int* get_samples(int number, int start, const char* fileName);
 
+/**
+ * Does the work for get_samples, but puts the samples in an array the caller already has.  The
+ * array must hold "number" + 1 values.  Returns 0 on success and 1 if the file can't be opened.
+ */
+int fill_samples(int* samples, int number, int start, const char* fileName);
+
 /**
  * Calculates the fourier transform of the samples provided for the k value provided.
  */
 double* calc_fourier(int* samples, int window_size, int k);
 
+/**
+ * Calculates the first "num_bins" values of the fourier transform of the samples at once, with
+ * the same sign as calc_fourier.  The real parts go in "re" and the imaginary parts in "im".
+ * num_bins can't be more than window_size.
+ */
+void calc_spectrum(const int *samples, int window_size, int num_bins, double *re, double *im);
+
+typedef struct fft_plan *FftPlanPtr;
+
+/**
+ * The tables needed to do a fast fourier transform of size n, which must be a power of two.
+ * These are calculated once so that transforming many blocks of the same size is cheap.
+ */
+typedef struct fft_plan
+{
+	int n;
+	int *bit_reverse;	/*Index each element is swapped with*/
+	double *cos_table;	/*cos(2*pi*k/n) for k < n/2*/
+	double *sin_table;	/*sin(2*pi*k/n) for k < n/2*/
+} FftPlan;
+
+/**
+ * Creates the plan for transforms of size n.  Returns NULL if n isn't a power of two.
+ */
+FftPlanPtr fft_plan_create(int n);
+
+/**
+ * Frees the plan.
+ */
+void fft_plan_destroy(FftPlanPtr plan);
+
+/**
+ * Does the transform in place on the real and imaginary arrays.  The forward transform uses
+ * the same sign as calc_fourier.  The inverse transform does not divide by n.
+ */
+void fft(FftPlanPtr plan, double *re, double *im, int inverse);
+
 /**
  * Verifies that the input is valid.
  */
@@ -32,4 +75,9 @@ int check_input(FileInfoPtr file_info);
  */
 unsigned* get_samples_stdin(int number, int bit_size);
 
+/**
+ * The same as get_samples_stdin, but the samples come from "inp".
+ */
+unsigned* get_samples_file(FILE *inp, int number, int bit_size);
+
 #endif
@@ -3,11 +3,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include "input_lib.h"
 #include "util.h"
 #include "fourier.h" 
+#include "envelope_lib.h"
+#include "handle_lib.h"
+#include "spectrum_lib.h"
+#include "perf_lib.h"
 
 #define MAX_FILE_NAME_LENGTH 100
+/*Number of waveform indexes kept open between calls*/
+#define ENVELOPE_CACHE_SIZE 8
+
+/*The most recently used indexes, newest first.  The lock is held while one is being used so
+it can't be thrown out of the cache in the middle.*/
+static WaveIndexPtr envelope_cache[ENVELOPE_CACHE_SIZE];
+static int envelope_cache_count = 0;
+static pthread_mutex_t envelope_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static WaveIndexPtr cached_index(const char *file_name);
+static jintArray samples_to_java(JNIEnv *env, jint number, jint start, jstring fileName);
+static jdoubleArray fourier_to_java(JNIEnv *env, jintArray samples, jint window_size, jint k);
+static void spectrum(const jint *samples, int window_size, int num_bins, jdouble *out,
+						int complex);
+static void throw_illegal_argument(JNIEnv *env, const char *message);
 
 /**
  * This file defines the jni functions that are called from JAVA in parts H and I.  In most 
@@ -18,6 +39,8 @@
  * I would have liked to only make one of each, but since it has to match the jni
  * signature exactly I was not able to.  However, they both call the same c function which
  * does all the real work anyway.
+ * The sample data is passed without extra copies where it can be: samples are read straight
+ * into direct ByteBuffers, and Java arrays are pinned while the c code uses them.
  */
 
 
@@ -29,101 +52,450 @@
 JNIEXPORT jintArray JNICALL Java_FHighLow_get_1samples(JNIEnv *env, jclass cls, 
 				jint number, jint start, jstring fileName)
 {
-	jintArray samples;
+	return samples_to_java(env, number, start, fileName);
+}
+
+/**
+ * This function calculates the fourier transform of the given samples with the provided k 
+ * value.  It is returned as a 2-element array in which the first element is the real part 
+ * and the second is the imaginary part.
+ */
+JNIEXPORT jdoubleArray JNICALL Java_FHighLow_calc_1fourier(JNIEnv *env, 
+				jclass cls, jintArray samples, jint window_size, jint k)
+{
+	return fourier_to_java(env, samples, window_size, k);
+}
+
+
+/*Functions for the second Java Class using jni.*/
+
+/**
+ * This function calculates the fourier transform of the given samples with the provided k 
+ * value.  It is returned as a 2-element array in which the first element is the real part 
+ * and the second is the imaginary part.
+ */
+JNIEXPORT jintArray JNICALL Java_SoundInfo_get_1samples(JNIEnv *env, jclass cls, 
+				jint number, jint start, jstring fileName)
+{
+	return samples_to_java(env, number, start, fileName);
+}
+
+/**
+ * This functions gets the "number" of samples from the file specified by "fileName".  The
+ * "start" parameter is a percent from 0 to 100 that determines where in the file the samples
+ * are read from.
+ */
+JNIEXPORT jdoubleArray JNICALL Java_SoundInfo_calc_1fourier(JNIEnv *env, 
+				jclass cls, jintArray samples, jint window_size, jint k)
+{
+	return fourier_to_java(env, samples, window_size, k);
+}
+
+/**
+ * Reads samples straight into a direct ByteBuffer from Java, so they don't have to be copied
+ * into a new array on every call.  The buffer is read as native order ints.  Its capacity sets
+ * the number of samples, which is one less than the number of ints it holds since the sample
+ * rate goes in the last one, just like get_samples.  Returns the number of samples read, or -1
+ * if the buffer isn't direct or the file can't be opened.
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_fill_1samples(JNIEnv *env, jclass cls,
+				jint start, jstring fileName, jobject buffer)
+{
 	const char *file_path;
-	int *result;
+	jint *samples;
+	jlong capacity;
+	int number, failed;
 	
-	samples = (*env)->NewIntArray(env, number+1);
+	samples = (jint*)(*env)->GetDirectBufferAddress(env, buffer);
+	capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+	if(samples == NULL || capacity < 2 * (jlong)sizeof(jint))
+	{
+		return -1;
+	}
+	number = capacity / sizeof(jint) - 1;
 	
 	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
+	failed = fill_samples(samples, number, start, file_path);
+	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
 	
-	/*Call the c function that does all the real work*/
-	result = get_samples(number, start, file_path);
+	return failed ? -1 : number;
+}
+
+/**
+ * Opens the file and keeps its parsed header and a map of its data until close_file is
+ * called, so read_window doesn't have to open and parse it again for every window.  The
+ * handle is returned to Java as a long, or 0 if the file couldn't be opened.
+ */
+JNIEXPORT jlong JNICALL Java_SoundInfo_open_1file(JNIEnv *env, jclass cls, jstring fileName)
+{
+	const char *file_path;
+	SoundHandlePtr handle;
 	
+	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
+	handle = handle_open(file_path);
 	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
 	
-	(*env)->SetIntArrayRegion(env, samples, 0, number+1, result);
+	return (jlong)(intptr_t)handle;
+}
+
+/**
+ * Closes a handle from open_file.  It can't be used again afterwards.
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_close_1file(JNIEnv *env, jclass cls, jlong handle)
+{
+	handle_close((SoundHandlePtr)(intptr_t)handle);
+}
+
+/**
+ * The same as fill_samples, but the samples come from a handle from open_file, so getting a
+ * window is just a copy from the right place in memory.  Returns the number of samples, or -1
+ * if the handle is 0 or the buffer isn't direct.
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_read_1window(JNIEnv *env, jclass cls,
+				jlong handle, jint start, jobject buffer)
+{
+	jint *samples;
+	jlong capacity;
+	int number;
 	
-	return samples;
+	samples = (jint*)(*env)->GetDirectBufferAddress(env, buffer);
+	capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+	if(handle == 0 || samples == NULL || capacity < 2 * (jlong)sizeof(jint))
+	{
+		return -1;
+	}
+	number = capacity / sizeof(jint) - 1;
+	
+	handle_read((SoundHandlePtr)(intptr_t)handle, number, start, samples);
+	return number;
 }
 
 /**
- * This function calculates the fourier transform of the given samples with the provided k 
- * value.  It is returned as a 2-element array in which the first element is the real part 
- * and the second is the imaginary part.
+ * Asks for the window of samples starting "start" percent of the way into the file and the
+ * magnitudes of its first "num_bins" fourier bins.  They are worked out on a background thread
+ * and kept in a cache, so this never waits.  If they're ready they are put in "samples" (a
+ * direct ByteBuffer like fill_samples uses) and "out", and 1 is returned.  Otherwise 0 is
+ * returned and Java should call again later with the same arguments.  Returns -1 if the file
+ * can't be opened or the arguments are bad.
  */
-JNIEXPORT jdoubleArray JNICALL Java_FHighLow_calc_1fourier(JNIEnv *env, 
-				jclass cls, jintArray samples, jint window_size, jint k)
+JNIEXPORT jint JNICALL Java_SoundInfo_poll_1spectrum(JNIEnv *env, jclass cls,
+				jstring fileName, jint start, jint window_size, jint num_bins,
+				jobject samples, jdoubleArray out)
 {
-	double* result;
-	jdoubleArray to_ret;
+	const char *file_path;
+	jint *elements;
+	double *result;
+	int state;
 	
-	jint *elements = (*env)->GetIntArrayElements(env, samples, 0);
+	elements = (jint*)(*env)->GetDirectBufferAddress(env, samples);
+	if(elements == NULL || window_size <= 0 || num_bins < 0 || num_bins > window_size ||
+			(*env)->GetDirectBufferCapacity(env, samples) <
+										(window_size + 1) * (jlong)sizeof(jint) ||
+			(*env)->GetArrayLength(env, out) < num_bins)
+	{
+		return SPECTRUM_FAILED;
+	}
 	
-	/*Call the c function that does all the real work*/
-	result = calc_fourier(elements, window_size, k);
+	/*spectrum_poll stats the file, locks and may queue work, so the array isn't pinned for it*/
+	result = (double*)perf_malloc((num_bins + 1) * sizeof(double));
+	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
+	state = spectrum_poll(file_path, start, window_size, num_bins, elements, result);
+	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
+	if(state == SPECTRUM_READY)
+	{
+		(*env)->SetDoubleArrayRegion(env, out, 0, num_bins, result);
+	}
+	free(result);
+	return state;
+}
+
+/**
+ * Returns the number of frames in the file, or -1 if it isn't a valid sound file.  This also
+ * loads or builds the file's waveform index so later calls to get_envelope are fast.
+ */
+JNIEXPORT jint JNICALL Java_SoundInfo_get_1num_1frames(JNIEnv *env, jclass cls,
+				jstring fileName)
+{
+	const char *file_path;
+	WaveIndexPtr index;
+	jint frames = -1;
 	
-	to_ret = (*env)->NewDoubleArray(env, 2);
+	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
+	pthread_mutex_lock(&envelope_lock);
+	if((index = cached_index(file_path)) != NULL)
+	{
+		frames = index->frames;
+	}
+	pthread_mutex_unlock(&envelope_lock);
+	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
 	
-	(*env)->ReleaseIntArrayElements(env, samples, elements, 0);
+	return frames;
+}
+
+/**
+ * Returns the envelope of frames "start" up to "end" of the file drawn "width" pixels wide.
+ * The array holds "width" minimums, then "width" maximums, then "width" RMS values.  Returns
+ * null if the file isn't valid or the range isn't in it.
+ */
+JNIEXPORT jdoubleArray JNICALL Java_SoundInfo_get_1envelope(JNIEnv *env, jclass cls,
+				jstring fileName, jint start, jint end, jint width)
+{
+	const char *file_path;
+	WaveIndexPtr index;
+	jdoubleArray to_ret = NULL;
+	double *result;
+	int failed = 1;
 	
-	(*env)->SetDoubleArrayRegion(env, to_ret, 0, 2, result);
+	if(width <= 0 || start < 0 || end <= start)
+	{
+		return NULL;
+	}
+	result = (double*)perf_malloc(3 * width * sizeof(double));
 	
+	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
+	pthread_mutex_lock(&envelope_lock);
+	if((index = cached_index(file_path)) != NULL)
+	{
+		failed = envelope_get(index, start, end, width, result, result + width,
+								result + 2*width);
+	}
+	pthread_mutex_unlock(&envelope_lock);
+	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
+	
+	if(!failed)
+	{
+		to_ret = (*env)->NewDoubleArray(env, 3 * width);
+		(*env)->SetDoubleArrayRegion(env, to_ret, 0, 3 * width, result);
+	}
+	free(result);
 	return to_ret;
 }
 
+/**
+ * Calculates the first "num_bins" values of the fourier transform of the samples in one call,
+ * instead of one call to calc_fourier per bin.  If "complex" is false, "out" gets the magnitude
+ * of each bin.  If it's true, "out" gets the real and imaginary parts of each bin one after the
+ * other.  "out" is filled in place so the same array can be used for every window.  Both
+ * arrays are pinned rather than copied while the transform is done.
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_calc_1spectrum(JNIEnv *env, jclass cls,
+				jintArray samples, jint window_size, jint num_bins, jdoubleArray out,
+				jboolean complex)
+{
+	jint *elements;
+	jdouble *out_elements;
+	
+	if(window_size <= 0 || num_bins < 0 || num_bins > window_size ||
+			(*env)->GetArrayLength(env, samples) < window_size ||
+			(*env)->GetArrayLength(env, out) < (complex ? 2*num_bins : num_bins))
+	{
+		throw_illegal_argument(env, "calc_spectrum: bad window size, number of bins, or array length");
+		return;
+	}
+	
+	/*No jni calls are allowed until both are released*/
+	elements = (jint*)(*env)->GetPrimitiveArrayCritical(env, samples, NULL);
+	out_elements = (jdouble*)(*env)->GetPrimitiveArrayCritical(env, out, NULL);
+	if(elements != NULL && out_elements != NULL)
+	{
+		spectrum(elements, window_size, num_bins, out_elements, complex);
+	}
+	if(out_elements != NULL)
+	{
+		(*env)->ReleasePrimitiveArrayCritical(env, out, out_elements, 0);
+	}
+	if(elements != NULL)
+	{
+		/*The samples weren't changed, so there's nothing to copy back*/
+		(*env)->ReleasePrimitiveArrayCritical(env, samples, elements, JNI_ABORT);
+	}
+}
 
-/*Functions for the second Java Class using jni.*/
+/**
+ * The same as calc_spectrum, but the samples come from a direct ByteBuffer filled by
+ * fill_samples, so they never have to be in a Java array at all.
+ */
+JNIEXPORT void JNICALL Java_SoundInfo_calc_1spectrum_1buffer(JNIEnv *env, jclass cls,
+				jobject samples, jint window_size, jint num_bins, jdoubleArray out,
+				jboolean complex)
+{
+	jint *elements;
+	jdouble *out_elements;
+	
+	elements = (jint*)(*env)->GetDirectBufferAddress(env, samples);
+	if(elements == NULL || window_size <= 0 || num_bins < 0 || num_bins > window_size ||
+			(*env)->GetDirectBufferCapacity(env, samples) < window_size * (jlong)sizeof(jint) ||
+			(*env)->GetArrayLength(env, out) < (complex ? 2*num_bins : num_bins))
+	{
+		throw_illegal_argument(env, "calc_spectrum_buffer: bad buffer, window size, "
+					"number of bins, or array length");
+		return;
+	}
+	
+	out_elements = (jdouble*)(*env)->GetPrimitiveArrayCritical(env, out, NULL);
+	if(out_elements != NULL)
+	{
+		spectrum(elements, window_size, num_bins, out_elements, complex);
+		(*env)->ReleasePrimitiveArrayCritical(env, out, out_elements, 0);
+	}
+}
 
 /**
- * This function calculates the fourier transform of the given samples with the provided k 
- * value.  It is returned as a 2-element array in which the first element is the real part 
- * and the second is the imaginary part.
+ * Reads samples with get_samples and returns them in a new Java array, freeing the c array
+ * afterwards.  Returns null if the file couldn't be opened.
  */
-JNIEXPORT jintArray JNICALL Java_SoundInfo_get_1samples(JNIEnv *env, jclass cls, 
-				jint number, jint start, jstring fileName)
+static jintArray samples_to_java(JNIEnv *env, jint number, jint start, jstring fileName)
 {
 	jintArray samples;
 	const char *file_path;
 	int *result;
 	
-	samples = (*env)->NewIntArray(env, number+1);
-	
 	file_path = (*env)->GetStringUTFChars(env, fileName, 0);
 	
 	/*Call the c function that does all the real work*/
 	result = get_samples(number, start, file_path);
 	
 	(*env)->ReleaseStringUTFChars(env, fileName, file_path);
+	if(result == NULL)
+	{
+		return NULL;
+	}
 	
+	samples = (*env)->NewIntArray(env, number+1);
 	(*env)->SetIntArrayRegion(env, samples, 0, number+1, result);
-
+	free(result);
+	
 	return samples;
 }
 
 /**
- * This functions gets the "number" of samples from the file specified by "fileName".  The
- * "start" parameter is a percent from 0 to 100 that determines where in the file the samples
- * are read from.
+ * Does one calc_fourier for a Java array of samples and returns the real and imaginary parts
+ * in a new 2-element Java array.  The samples are pinned rather than copied.
  */
-JNIEXPORT jdoubleArray JNICALL Java_SoundInfo_calc_1fourier(JNIEnv *env, 
-				jclass cls, jintArray samples, jint window_size, jint k)
+static jdoubleArray fourier_to_java(JNIEnv *env, jintArray samples, jint window_size, jint k)
 {
 	double* result;
 	jdoubleArray to_ret;
+	jint *elements;
 	
-	jint *elements = (*env)->GetIntArrayElements(env, samples, 0);
+	if(window_size <= 0 || (*env)->GetArrayLength(env, samples) < window_size)
+	{
+		throw_illegal_argument(env, "calc_fourier: bad window size or array length");
+		return NULL;
+	}
 	
+	elements = (jint*)(*env)->GetPrimitiveArrayCritical(env, samples, NULL);
+	if(elements == NULL)
+	{
+		return NULL;
+	}
 	/*Call the c function that does all the real work*/
 	result = calc_fourier(elements, window_size, k);
+	(*env)->ReleasePrimitiveArrayCritical(env, samples, elements, JNI_ABORT);
 	
 	to_ret = (*env)->NewDoubleArray(env, 2);
-	
-	(*env)->ReleaseIntArrayElements(env, samples, elements, 0);
-	
 	(*env)->SetDoubleArrayRegion(env, to_ret, 0, 2, result);
+	free(result);
 	
 	return to_ret;
 }
 
+/**
+ * Works out the spectrum for calc_spectrum into "out", which holds magnitudes or interleaved
+ * real and imaginary parts depending on "complex".  This is called while Java arrays are
+ * pinned, so it must not make any jni calls.
+ */
+static void spectrum(const jint *samples, int window_size, int num_bins, jdouble *out,
+						int complex)
+{
+	double *re, *im;
+	int k;
+	
+	re = (double*)perf_malloc((num_bins + 1) * sizeof(double));
+	im = (double*)perf_malloc((num_bins + 1) * sizeof(double));
+	
+	/*Call the c function that does all the real work*/
+	calc_spectrum(samples, window_size, num_bins, re, im);
+	
+	for(k=0; k<num_bins; k++)
+	{
+		if(complex)
+		{
+			out[2*k] = re[k];
+			out[2*k+1] = im[k];
+		}
+		else
+		{
+			out[k] = sqrt(re[k]*re[k] + im[k]*im[k]);
+		}
+	}
+	free(re);
+	free(im);
+}
+
+/**
+ * Throws an IllegalArgumentException with the message in Java once this native call returns.
+ */
+static void throw_illegal_argument(JNIEnv *env, const char *message)
+{
+	jclass exception = (*env)->FindClass(env, "java/lang/IllegalArgumentException");
+	
+	if(exception != NULL)
+	{
+		(*env)->ThrowNew(env, exception, message);
+	}
+}
 
+/**
+ * Finds the index for the file in the cache, or opens it and adds it to the cache.  The one
+ * used longest ago is thrown out when the cache is full, and so is one made from the file
+ * before it was last changed.  envelope_lock must be held.
+ */
+static WaveIndexPtr cached_index(const char *file_name)
+{
+	WaveIndexPtr index = NULL;
+	int i, found = -1;
+	
+	for(i=0; i<envelope_cache_count; i++)
+	{
+		if(strcmp(envelope_cache[i]->file_name, file_name) == 0)
+		{
+			found = i;
+			break;
+		}
+	}
+	if(found >= 0 && !envelope_current(envelope_cache[found]))
+	{
+		envelope_destroy(envelope_cache[found]);
+		for(i=found; i<envelope_cache_count-1; i++)
+		{
+			envelope_cache[i] = envelope_cache[i+1];
+		}
+		envelope_cache_count--;
+		found = -1;
+	}
+	if(found >= 0)
+	{
+		index = envelope_cache[found];
+	}
+	else
+	{
+		if((index = envelope_open(file_name)) == NULL)
+		{
+			return NULL;
+		}
+		if(envelope_cache_count == ENVELOPE_CACHE_SIZE)
+		{
+			envelope_destroy(envelope_cache[--envelope_cache_count]);
+		}
+		found = envelope_cache_count++;
+	}
+	
+	/*Move it to the front*/
+	for(i=found; i>0; i--)
+	{
+		envelope_cache[i] = envelope_cache[i-1];
+	}
+	envelope_cache[0] = index;
+	return index;
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sine_lib.h"
+#include "signal_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+
+#define MILLSEC_TO_SEC .001
+#define NUM_BUTTONS 16
+
+/*The same settings the gendtmf.sh script passes to gensine*/
+#define BIT_SIZE 8
+#define SAMPLE_RATE 8000
+#define AMPLITUDE 100
+
+int button_index(const char *label);
+unsigned* make_tone(int button, double duration, int num_samples);
+
+/**
+ * Part G: gendtmf
+ * Simulates the pressing of a sequence of buttons on a telephone by generating the dtmf signal
+ * for each one with a pause in between them.  This does what gendtmf2.sh does with gendtmf.sh,
+ * gensine, mix and merge, but does it all in one process without any temporary files.  The
+ * output is the same as the scripts.  Each button's tone is only generated once, no matter how
+ * many times it's pressed.
+ *
+ * Command Line Variables: gendtmf <pause in ms> <duration in seconds> <button> [button ...]
+ *			buttons are 0-9, A-D, and S or * for star and P or # for pound
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	int pause, num_samples, i, button;
+	double duration;
+	unsigned *tones[NUM_BUTTONS];
+	unsigned *silence;
+	FileInfo header;
+	SignalStats stats;
+	unsigned long long perf_start;
+
+	perf_init(&argc, argv);
+	
+	if(argc < 4)
+	{
+		fprintf(stderr, "You must provide at least three parameters.\n");
+		return 1;
+	}
+	pause = atoi(argv[1]);
+	duration = atof(argv[2]);
+	if(pause < 0 || duration < 0)
+	{
+		fprintf(stderr, "The pause and duration must not be negative.\n");
+		return 1;
+	}
+
+	/*Check all the buttons before anything is output*/
+	for(i=3; i<argc; i++)
+	{
+		if(button_index(argv[i]) < 0)
+		{
+			fprintf(stderr, "You must enter a valid button.\n");
+			return 1;
+		}
+	}
+
+	/*Same conversions as gensine and merge*/
+	num_samples = SAMPLE_RATE * duration;
+	pause = pause*MILLSEC_TO_SEC*SAMPLE_RATE;
+	silence = (unsigned*)perf_calloc(pause > 0 ? pause : 1, sizeof(unsigned));
+	for(i=0; i<NUM_BUTTONS; i++)
+	{
+		tones[i] = NULL;
+	}
+
+	/*Make every tone that's needed, so the statistics can be worked out for the header*/
+	stats_init(&stats, 1, BIT_SIZE);
+	for(i=3; i<argc; i++)
+	{
+		button = button_index(argv[i]);
+		if(tones[button] == NULL)
+		{
+			PERF_START(perf_start);
+			tones[button] = make_tone(button, duration, num_samples);
+			PERF_STOP(PERF_COMPUTE_NS, "make_tone", perf_start);
+			perf_add(PERF_SAMPLES_PROCESSED, num_samples);
+		}
+		if(i > 3)
+		{
+			stats_add(&stats, silence, pause);
+		}
+		stats_add(&stats, tones[button], num_samples);
+	}
+	
+	/*This is the header merge prints, it doesn't have the number of samples*/
+	header.frequency = SAMPLE_RATE;
+	header.mono_or_stereo = MONO;
+	header.bit_size = BIT_SIZE;
+	stats_to_header(&stats, &header);
+	write_stats_header(stdout, &header, 0);
+	
+	for(i=3; i<argc; i++)
+	{
+		button = button_index(argv[i]);
+		if(i > 3)
+		{
+			output_samples(stdout, silence, pause, BIT_SIZE);
+		}
+		output_samples(stdout, tones[button], num_samples, BIT_SIZE);
+	}
+	
+	for(i=0; i<NUM_BUTTONS; i++)
+	{
+		free(tones[i]);
+	}
+	free(silence);
+	return 0;
+}
+
+/**
+ * Returns the index of the button with the given label, or -1 if it isn't a button.  The
+ * buttons are numbered row by row, the same order dtmf uses.
+ */
+int button_index(const char *label)
+{
+	const char *buttons = "123A456B789C*0#D";
+	const char *found;
+
+	if(strlen(label) != 1)
+	{
+		return -1;
+	}
+	/*The scripts use S and P since * and # are special to the shell*/
+	if(label[0] == 'S')
+	{
+		return 12;
+	}
+	if(label[0] == 'P')
+	{
+		return 14;
+	}
+	if((found = strchr(buttons, label[0])) == NULL)
+	{
+		return -1;
+	}
+	return found - buttons;
+}
+
+/**
+ * Generates the tone for a button the way gendtmf.sh does: the row and column frequencies are
+ * each generated by gensine, then mixed with gains of 1.0 and scaled so the peak is 90% of
+ * the largest possible sample.  Returns a malloc'ed array of num_samples samples.
+ */
+unsigned* make_tone(int button, double duration, int num_samples)
+{
+	int row_freqs[] = {697, 770, 852, 941};
+	int col_freqs[] = {1209, 1336, 1477, 1633};
+	SineProp row, col;
+	Oscillator osc;
+	unsigned *tone, *other;
+	unsigned max_sample = 0;
+	double scale_factor;
+	int i;
+
+	row.mono_or_stereo = MONO;
+	row.frequency = row_freqs[button / 4];
+	row.bit_size = BIT_SIZE;
+	row.sample_rate = SAMPLE_RATE;
+	row.amplitude = AMPLITUDE;
+	row.duration = duration;
+	col = row;
+	col.frequency = col_freqs[button % 4];
+
+	tone = (unsigned*)perf_malloc((num_samples > 0 ? num_samples : 1) * sizeof(unsigned));
+	other = (unsigned*)perf_malloc((num_samples > 0 ? num_samples : 1) * sizeof(unsigned));
+	osc_init(&osc, row.frequency, row.sample_rate);
+	fill_wave(&row, &osc, tone, num_samples);
+	osc_init(&osc, col.frequency, col.sample_rate);
+	fill_wave(&col, &osc, other, num_samples);
+
+	/*The mixing math from mix_files*/
+	for(i=0; i<num_samples; i++)
+	{
+		tone[i] += other[i];
+		if(max_sample < tone[i])
+		{
+			max_sample = tone[i];
+		}
+	}
+	scale_factor = ((pow(2, BIT_SIZE))-1) / (double)max_sample;
+	scale_factor = scale_factor * 0.9;
+	for(i=0; i<num_samples; i++)
+	{
+		tone[i] = (unsigned)(tone[i] * scale_factor);
+	}
+
+	free(other);
+	return tone;
+}
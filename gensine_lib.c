@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+/*limits.h needed for using INT_MAX*/
+#include <limits.h>
+#include "gensine_lib.h"
+#include "signal_lib.h"
+
+/*Define the index of each argument*/
+#define IND_MON_STER 0
+#define IND_FREQ 1
+#define IND_BIT_SIZE 2
+#define IND_SAMP_RATE 3
+#define IND_AMP 4
+#define IND_DUR 5
+
+static void write_sine_header(FILE *out, SinePropPtr sin_prop_ptr, int number_of_samples);
+
+/**
+ * Writes the header, with the statistics of the wave, and then the wave itself to "out".
+ */
+void gensine_write(FILE *out, SinePropPtr sin_prop_ptr)
+{
+	int number_of_samples = (sin_prop_ptr->sample_rate) * (sin_prop_ptr->duration);
+	
+	write_sine_header(out, sin_prop_ptr, number_of_samples);
+	write_wave(out, sin_prop_ptr);
+}
+
+/**
+ * Checks that the command line arguments are all legal and puts them in the struct.
+ * Returns 0 if they are all legal, and 1 if they are not.
+ * Returns 1 and prints to stderr if any of the arguments are illegal
+ */
+int gensine_args(char* inp[], SinePropPtr sin_prop_ptr)
+{	
+	/*Check that the first arg is "MONO" or "STEREO"*/
+	if(strncmp(inp[IND_MON_STER], "MONO", 4)==0 && strlen(inp[IND_MON_STER])==4)
+	{
+		sin_prop_ptr->mono_or_stereo = MONO;	/*0 for MONO*/
+	}
+	else if(strncmp(inp[IND_MON_STER], "STEREO", 6)==0 && strlen(inp[IND_MON_STER])==6)
+	{
+		sin_prop_ptr->mono_or_stereo = STEREO; /*1 for STEREO*/
+	}
+	else
+	{
+		fprintf(stderr, "The first command line argument must be \"MONO\" or \"STEREO\".\n");
+		return 1;
+	}
+	
+	/*Check that the freq and sample rate are both legal integer values*/
+	sin_prop_ptr->frequency = atoi(inp[IND_FREQ]);
+	if(sin_prop_ptr->frequency < 0 || sin_prop_ptr->frequency >= INT_MAX)
+	{
+		fprintf(stderr, "The value for frequency is not a legal positive integer.\n");
+		return(1);
+	}
+	sin_prop_ptr->sample_rate = atoi(inp[IND_SAMP_RATE]);
+	if(sin_prop_ptr->sample_rate < 0 || sin_prop_ptr->sample_rate >= INT_MAX)
+	{
+		fprintf(stderr, "The value for sample rate is not a legal positive integer.\n");
+		return 1;
+	}
+	
+	/*Check that the frequency is not more than twice the sampling rate*/
+	if(sin_prop_ptr->frequency > (sin_prop_ptr->sample_rate / 2))
+	{
+		fprintf(stderr, "The value for frequency can't be more than twice the sample rate.\n");
+		return 1;
+	}
+	
+	/*Check that the bitsize is either 8, 16, or 32 bits*/
+	sin_prop_ptr->bit_size = atoi(inp[IND_BIT_SIZE]);
+	if((sin_prop_ptr->bit_size != 8) && (sin_prop_ptr->bit_size != 16) && 
+												(sin_prop_ptr->bit_size != 32))
+	{
+		fprintf(stderr, "The value for bit-size must be 8, 16, or 32\n");
+		return 1;
+	}
+	
+	/*Check that the amplitude is > 0 and < (2^bitsize)-1*/
+	sin_prop_ptr->amplitude = atoi(inp[IND_AMP]);
+	if((sin_prop_ptr->amplitude < 0) || 
+			(sin_prop_ptr->amplitude > (unsigned)(pow(2, sin_prop_ptr->bit_size))-1))
+	{
+		fprintf(stderr, "The value for amplitude must be > 0 and < 2^bit-size\n");
+		return 1;
+	}
+	
+	/*Check that the duration is > 0*/
+	sin_prop_ptr->duration = atof(inp[IND_DUR]);
+	if((sin_prop_ptr->duration < 0))
+	{
+		fprintf(stderr, "The value for duration is not a positive number.\n");
+		return 1;
+	}
+	
+	/*If all these checks are passed, then the cmd line arguments are valid*/
+	return 0;
+}
+
+/**
+ * Writes the header for the wave to "out".  The header comes before the data, so to know the wave's
+ * statistics the wave is generated once here without being output.
+ */
+static void write_sine_header(FILE *out, SinePropPtr sin_prop_ptr, int number_of_samples)
+{
+	FileInfo header;
+	SignalStats stats;
+	Oscillator osc;
+	unsigned result[2*WAVE_BLOCK];
+	int i, count;
+	
+	stats_init(&stats, 1, sin_prop_ptr->bit_size);
+	osc_init(&osc, sin_prop_ptr->frequency, sin_prop_ptr->sample_rate);
+	for(i=0; i<number_of_samples; i+=WAVE_BLOCK)
+	{
+		count = wave_block(sin_prop_ptr, &osc, result, number_of_samples - i);
+		stats_add(&stats, result, count);
+	}
+	
+	header.frequency = sin_prop_ptr->sample_rate;
+	header.num_samples = number_of_samples;
+	header.mono_or_stereo = sin_prop_ptr->mono_or_stereo;
+	header.bit_size = sin_prop_ptr->bit_size;
+	stats_to_header(&stats, &header);
+	write_stats_header(out, &header, 1);
+}
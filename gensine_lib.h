@@ -0,0 +1,23 @@
+#ifndef GENSINE_LIB_H_
+#define GENSINE_LIB_H_
+
+#include <stdio.h>
+#include "sine_lib.h"
+
+/*Number of arguments that describe a sine wave*/
+#define GENSINE_ARGS 6
+
+/**
+ * Checks the GENSINE_ARGS arguments that describe a sine wave
+ * (MONO | STEREO, frequency, bit-size, sample rate, amplitude, duration) and puts them in the
+ * struct.  Returns 0 if they are all legal, and 1 (error written to stderr) if they are not.
+ */
+int gensine_args(char *inp[], SinePropPtr sin_prop_ptr);
+
+/**
+ * Writes the sine wave to "out", with a header that includes the PEAK, RMS and CHECKSUM of the
+ * wave.
+ */
+void gensine_write(FILE *out, SinePropPtr sin_prop_ptr);
+
+#endif
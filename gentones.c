@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <pthread.h>
+#include "sine_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include "pool_lib.h"
+
+#define MAX_LINE_LENGTH 200
+#define MAX_NAME_LENGTH 200
+#define MAX_COMPONENTS 32
+
+/*Types of tone components*/
+#define TONE_SINE 0
+#define TONE_LIN_SWEEP 1
+#define TONE_LOG_SWEEP 2
+
+/**
+ * One sine or sweep that is part of an output file.  For a plain sine the start and end
+ * frequencies are the same.
+ */
+typedef struct tone_component
+{
+	int type;
+	double start_freq;
+	double end_freq;
+	unsigned amplitude;
+} ToneComponent;
+
+typedef struct tone_job *ToneJobPtr;
+
+/**
+ * Everything needed to generate one output file.
+ */
+typedef struct tone_job
+{
+	char file_name[MAX_NAME_LENGTH];
+	int mono_or_stereo;
+	int bit_size;
+	int sample_rate;
+	double duration;
+	double attack;		/*Seconds to fade in*/
+	double release;		/*Seconds to fade out*/
+	int num_components;
+	ToneComponent components[MAX_COMPONENTS];
+} ToneJob;
+
+/**
+ * The list of jobs shared by the pool's threads.
+ */
+typedef struct job_queue
+{
+	ToneJobPtr jobs;
+	int num_jobs;
+	int failures;
+	pthread_mutex_t lock;
+} JobQueue;
+
+int load_jobs(FILE *inp, ToneJobPtr *jobs_out);
+int check_job(ToneJobPtr job, int line_num);
+int render_job(ToneJobPtr job);
+void render_jobs(void *arg, int from, int to);
+
+/**
+ * Gentones
+ * Generates many sound files from one job file, each one a sum of sines and frequency sweeps
+ * with an optional fade in and fade out.  The files are generated in parallel.  The job file
+ * has one block like this for each output file (lines starting with # are ignored):
+ *
+ *	file <output name> <MONO | STEREO> <bit-size> <sample rate> <duration>
+ *	sine <frequency> <amplitude>
+ *	sweep <LIN | LOG> <start frequency> <end frequency> <amplitude>
+ *	envelope <attack seconds> <release seconds>
+ *	end
+ *
+ * A single sine with no envelope gives the same samples as gensine.
+ *
+ * Command Line Variables: gentones <job file> [threads]
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	FILE *inp;
+	JobQueue queue;
+
+	perf_init(&argc, argv);
+	
+	if(argc != 2 && argc != 3)
+	{
+		fprintf(stderr, "You must provide the job file and optionally the number of threads.\n");
+		return 1;
+	}
+	if((inp = fopen(argv[1], "r")) == NULL)
+	{
+		fprintf(stderr, "Cannot open: %s\n", argv[1]);
+		return 1;
+	}
+	/*The whole job file is checked before anything is generated*/
+	queue.num_jobs = load_jobs(inp, &queue.jobs);
+	fclose(inp);
+	if(queue.num_jobs < 0)
+	{
+		return 1;
+	}
+
+	if(argc == 3)
+	{
+		pool_init(atoi(argv[2]));
+	}
+
+	sine_table_init();
+	queue.failures = 0;
+	pthread_mutex_init(&queue.lock, NULL);
+	/*One job at a time, since they can be very different lengths*/
+	pool_parallel_for(0, queue.num_jobs, 1, render_jobs, &queue);
+	pthread_mutex_destroy(&queue.lock);
+
+	free(queue.jobs);
+	return (queue.failures == 0) ? 0 : 1;
+}
+
+/**
+ * Pool function.  Renders jobs "from" to "to" of the queue.
+ */
+void render_jobs(void *arg, int from, int to)
+{
+	JobQueue *queue = (JobQueue*)arg;
+	int job;
+
+	for(job=from; job<to; job++)
+	{
+		if(render_job(&queue->jobs[job]) != 0)
+		{
+			pthread_mutex_lock(&queue->lock);
+			queue->failures++;
+			pthread_mutex_unlock(&queue->lock);
+		}
+	}
+}
+
+/**
+ * Reads all the jobs from the job file into a malloc'ed array.  Returns the number of jobs, or
+ * -1 if there's an error in the file (written to stderr).
+ */
+int load_jobs(FILE *inp, ToneJobPtr *jobs_out)
+{
+	char line[MAX_LINE_LENGTH];
+	char word[MAX_LINE_LENGTH];
+	char channels[MAX_LINE_LENGTH];
+	char kind[MAX_LINE_LENGTH];
+	int line_num = 0;
+	int num_jobs = 0;
+	int capacity = 16;
+	int in_job = 0;
+	ToneJobPtr jobs = (ToneJobPtr)perf_malloc(capacity * sizeof(ToneJob));
+	ToneJobPtr job = NULL;
+	ToneComponent *comp;
+
+	while(fgets(line, MAX_LINE_LENGTH, inp) != NULL)
+	{
+		line_num++;
+		if(sscanf(line, "%s", word) != 1 || word[0] == '#')
+		{
+			continue;
+		}
+
+		if(strcasecmp(word, "file") == 0)
+		{
+			if(in_job)
+			{
+				fprintf(stderr, "Line %d: \"end\" is missing before the next file.\n", line_num);
+				free(jobs);
+				return -1;
+			}
+			if(num_jobs == capacity)
+			{
+				capacity = capacity * 2;
+				jobs = (ToneJobPtr)perf_realloc(jobs, capacity * sizeof(ToneJob));
+			}
+			job = &jobs[num_jobs];
+			memset(job, 0, sizeof(ToneJob));
+			if(sscanf(line, "%*s %199s %s %d %d %lf", job->file_name, channels,
+					&job->bit_size, &job->sample_rate, &job->duration) != 5)
+			{
+				fprintf(stderr, "Line %d: file needs a name, channels, bit-size, ", line_num);
+				fprintf(stderr, "sample rate and duration.\n");
+				free(jobs);
+				return -1;
+			}
+			if(strcasecmp(channels, "MONO") == 0)
+			{
+				job->mono_or_stereo = MONO;
+			}
+			else if(strcasecmp(channels, "STEREO") == 0)
+			{
+				job->mono_or_stereo = STEREO;
+			}
+			else
+			{
+				fprintf(stderr, "Line %d: channels must be \"MONO\" or \"STEREO\".\n", line_num);
+				free(jobs);
+				return -1;
+			}
+			in_job = 1;
+		}
+		else if(!in_job)
+		{
+			fprintf(stderr, "Line %d: \"%s\" must come after a file line.\n", line_num, word);
+			free(jobs);
+			return -1;
+		}
+		else if(strcasecmp(word, "sine") == 0 || strcasecmp(word, "sweep") == 0)
+		{
+			if(job->num_components == MAX_COMPONENTS)
+			{
+				fprintf(stderr, "Line %d: a file can have at most %d tones.\n", line_num,
+								MAX_COMPONENTS);
+				free(jobs);
+				return -1;
+			}
+			comp = &job->components[job->num_components];
+			if(strcasecmp(word, "sine") == 0)
+			{
+				comp->type = TONE_SINE;
+				if(sscanf(line, "%*s %lf %u", &comp->start_freq, &comp->amplitude) != 2)
+				{
+					fprintf(stderr, "Line %d: sine needs a frequency and amplitude.\n",
+								line_num);
+					free(jobs);
+					return -1;
+				}
+				comp->end_freq = comp->start_freq;
+			}
+			else
+			{
+				if(sscanf(line, "%*s %s %lf %lf %u", kind, &comp->start_freq, &comp->end_freq,
+							&comp->amplitude) != 4 ||
+						(strcasecmp(kind, "LIN") != 0 && strcasecmp(kind, "LOG") != 0))
+				{
+					fprintf(stderr, "Line %d: sweep needs LIN or LOG, start and end ", line_num);
+					fprintf(stderr, "frequencies, and an amplitude.\n");
+					free(jobs);
+					return -1;
+				}
+				comp->type = (strcasecmp(kind, "LIN") == 0) ? TONE_LIN_SWEEP : TONE_LOG_SWEEP;
+			}
+			job->num_components++;
+		}
+		else if(strcasecmp(word, "envelope") == 0)
+		{
+			if(sscanf(line, "%*s %lf %lf", &job->attack, &job->release) != 2)
+			{
+				fprintf(stderr, "Line %d: envelope needs attack and release times.\n", line_num);
+				free(jobs);
+				return -1;
+			}
+		}
+		else if(strcasecmp(word, "end") == 0)
+		{
+			if(check_job(job, line_num) != 0)
+			{
+				free(jobs);
+				return -1;
+			}
+			num_jobs++;
+			in_job = 0;
+		}
+		else
+		{
+			fprintf(stderr, "Line %d: unknown keyword \"%s\".\n", line_num, word);
+			free(jobs);
+			return -1;
+		}
+	}
+
+	if(in_job)
+	{
+		fprintf(stderr, "The last file in the job file is missing \"end\".\n");
+		free(jobs);
+		return -1;
+	}
+	*jobs_out = jobs;
+	return num_jobs;
+}
+
+/**
+ * Checks that a job has legal values, with the same rules gensine uses.  Returns 0 if it's
+ * legal and 1 if not.
+ */
+int check_job(ToneJobPtr job, int line_num)
+{
+	double max_sample;
+	double total_amp = 0.0;
+	int i;
+
+	if((job->bit_size != 8) && (job->bit_size != 16) && (job->bit_size != 32))
+	{
+		fprintf(stderr, "Line %d: the value for bit-size must be 8, 16, or 32\n", line_num);
+		return 1;
+	}
+	if(job->sample_rate <= 0)
+	{
+		fprintf(stderr, "Line %d: the sample rate must be a positive integer.\n", line_num);
+		return 1;
+	}
+	if(job->duration < 0 || job->attack < 0 || job->release < 0)
+	{
+		fprintf(stderr, "Line %d: times can't be negative.\n", line_num);
+		return 1;
+	}
+	max_sample = pow(2, job->bit_size) - 1;
+	for(i=0; i<job->num_components; i++)
+	{
+		ToneComponent *comp = &job->components[i];
+		if(comp->start_freq <= 0 || comp->end_freq <= 0 ||
+				comp->start_freq > job->sample_rate / 2 || comp->end_freq > job->sample_rate / 2)
+		{
+			fprintf(stderr, "Line %d: frequencies must be positive and no more than half ",
+						line_num);
+			fprintf(stderr, "the sample rate.\n");
+			return 1;
+		}
+		total_amp += comp->amplitude;
+	}
+	if(total_amp > max_sample)
+	{
+		fprintf(stderr, "Line %d: the amplitudes add up to more than 2^bit-size - 1.\n",
+					line_num);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Generates one file.  Returns 0 on success and 1 if the file can't be written.
+ */
+int render_job(ToneJobPtr job)
+{
+	FILE *out;
+	int num_samples = job->sample_rate * job->duration;
+	int channels = (job->mono_or_stereo == STEREO) ? 2 : 1;
+	int attack = job->attack * job->sample_rate;
+	int release = job->release * job->sample_rate;
+	double acc[WAVE_BLOCK];
+	double values[WAVE_BLOCK];
+	unsigned long long phases[WAVE_BLOCK];
+	unsigned long long sweep_phase[MAX_COMPONENTS];
+	unsigned result[2*WAVE_BLOCK];
+	Oscillator osc[MAX_COMPONENTS];
+	double offset = 0.0;
+	double max_sample = pow(2, job->bit_size) - 1;
+	double half_amp, t, freq, env, value;
+	int i, j, c, n;
+	unsigned long long perf_start;
+
+	if((out = fopen(job->file_name, "w")) == NULL)
+	{
+		fprintf(stderr, "Cannot open: %s\n", job->file_name);
+		return 1;
+	}
+	write_header(out, job->sample_rate, num_samples, job->mono_or_stereo, job->bit_size);
+
+	/*Each tone swings around half its amplitude, like gensine*/
+	for(c=0; c<job->num_components; c++)
+	{
+		offset += job->components[c].amplitude/2;
+		osc_init(&osc[c], job->components[c].start_freq, job->sample_rate);
+		sweep_phase[c] = 0;
+	}
+
+	for(i=0; i<num_samples; i+=WAVE_BLOCK)
+	{
+		n = num_samples - i;
+		if(n > WAVE_BLOCK)
+		{
+			n = WAVE_BLOCK;
+		}
+		PERF_START(perf_start);
+		for(j=0; j<n; j++)
+		{
+			acc[j] = 0.0;
+		}
+
+		for(c=0; c<job->num_components; c++)
+		{
+			ToneComponent *comp = &job->components[c];
+			half_amp = comp->amplitude/2;
+			if(comp->type == TONE_SINE)
+			{
+				osc_fill(&osc[c], values, n);
+			}
+			else
+			{
+				/*The phase moves by the frequency at each sample*/
+				for(j=0; j<n; j++)
+				{
+					t = (double)(i + j) / num_samples;
+					if(comp->type == TONE_LIN_SWEEP)
+					{
+						freq = comp->start_freq + (comp->end_freq - comp->start_freq) * t;
+					}
+					else
+					{
+						freq = comp->start_freq * pow(comp->end_freq / comp->start_freq, t);
+					}
+					phases[j] = sweep_phase[c];
+					sweep_phase[c] += (unsigned long long)ldexp(freq / job->sample_rate, 64);
+				}
+				phase_sin(phases, values, n);
+			}
+			for(j=0; j<n; j++)
+			{
+				acc[j] += values[j] * half_amp;
+			}
+		}
+
+		for(j=0; j<n; j++)
+		{
+			env = 1.0;
+			if(attack > 0 && i + j < attack)
+			{
+				env = (double)(i + j) / attack;
+			}
+			if(release > 0 && num_samples - (i + j) < release)
+			{
+				env = env * (num_samples - (i + j)) / release;
+			}
+			value = acc[j] * env + offset;
+			if(value < 0.0)
+			{
+				value = 0.0;
+			}
+			else if(value > max_sample)
+			{
+				value = max_sample;
+			}
+			result[j*channels] = (unsigned)value;
+			if(channels == 2)
+			{
+				result[j*2 + 1] = result[j*2];
+			}
+		}
+		PERF_STOP(PERF_COMPUTE_NS, "render_block", perf_start);
+		perf_add(PERF_SAMPLES_PROCESSED, n*channels);
+		output_samples(out, result, n*channels, job->bit_size);
+	}
+
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "handle_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Opens the file, parses its header and maps it into memory.  The header is parsed with the
+ * normal stdio code and the data is then found at the same offset in the map.  If the header
+ * has no SAMPLE field the number of samples is worked out from the size of the data instead
+ * of by reading it.  Returns NULL if the file can't be opened or mapped, or if the header
+ * isn't valid.
+ */
+SoundHandlePtr handle_open(const char *file_name)
+{
+	SoundHandlePtr handle;
+	FILE *inp;
+	struct stat st;
+	long data_offset;
+	int bytes_per_sample, channels;
+
+	if((inp = fopen(file_name, "r")) == NULL)
+	{
+		fprintf(stderr, "Could not open file %s.\n", file_name);
+		return NULL;
+	}
+	handle = (SoundHandlePtr)perf_malloc(sizeof(SoundHandle));
+	if(parse_header(inp, &handle->info, NONE) != 0 || fstat(fileno(inp), &st) != 0)
+	{
+		fclose(inp);
+		free(handle);
+		return NULL;
+	}
+	data_offset = ftell(inp);
+	handle->map_size = st.st_size;
+	handle->map = NULL;
+	if(handle->map_size > 0)
+	{
+		handle->map = mmap(NULL, handle->map_size, PROT_READ, MAP_PRIVATE, fileno(inp), 0);
+	}
+	/*The map stays valid after the file is closed*/
+	fclose(inp);
+	if(handle->map == NULL || handle->map == MAP_FAILED)
+	{
+		fprintf(stderr, "Could not map file %s.\n", file_name);
+		free(handle);
+		return NULL;
+	}
+
+	bytes_per_sample = handle->info.bit_size / 8;
+	channels = (handle->info.mono_or_stereo == STEREO) ? 2 : 1;
+	handle->data = (const unsigned char*)handle->map + data_offset;
+	handle->num_values = (handle->map_size - data_offset) / bytes_per_sample;
+	if(handle->info.num_samples == 0)
+	{
+		handle->info.num_samples = handle->num_values / channels;
+	}
+	return handle;
+}
+
+/**
+ * Unmaps the file and frees the handle.
+ */
+void handle_close(SoundHandlePtr handle)
+{
+	if(handle == NULL)
+	{
+		return;
+	}
+	munmap(handle->map, handle->map_size);
+	free(handle);
+}
+
+/**
+ * Fills "samples" the same way fill_samples in fourier.h does: "number" values starting
+ * "start" percent of the way into the file, and then the sample rate.  The starting point is
+ * moved back if there aren't "number" values after it.  Since the data is already in memory
+ * this is just a copy from the right offset.  If the file is too short the rest of the window
+ * is filled with silence.  Returns the number of values that were in the file.
+ */
+int handle_read(SoundHandlePtr handle, int number, int start, int *samples)
+{
+	int bytes_per_sample = handle->info.bit_size / 8;
+	unsigned starting_sample = 0;
+	unsigned available;
+	int i;
+
+	if(start != 0)
+	{
+		starting_sample = ((unsigned long long)start * handle->info.num_samples) / 100;
+	}
+	/*Make sure there are still enough samples left in the file*/
+	if(starting_sample + number > handle->num_values)
+	{
+		starting_sample = (handle->num_values > (unsigned)number) ?
+								handle->num_values - number : 0;
+	}
+	available = handle->num_values - starting_sample;
+	if(available > (unsigned)number)
+	{
+		available = number;
+	}
+
+	/*Copy the raw bytes to the front of the array and unpack them in place*/
+	memcpy(samples, handle->data + (size_t)starting_sample * bytes_per_sample,
+				(size_t)available * bytes_per_sample);
+	unpack_samples((unsigned*)samples, available, handle->info.bit_size);
+	if(available < (unsigned)number)
+	{
+		fprintf(stderr, "The file did not contain enough samples. %u\n", available);
+		for(i=available; i<number; i++)
+		{
+			samples[i] = 1u << (handle->info.bit_size - 1);
+		}
+	}
+	samples[number] = handle->info.frequency;
+	return available;
+}
@@ -0,0 +1,40 @@
+#ifndef HANDLE_LIB_H_
+#define HANDLE_LIB_H_
+
+#include <stddef.h>
+#include "input_lib.h"
+
+typedef struct sound_handle *SoundHandlePtr;
+
+/**
+ * An open sound file whose header has been parsed once and whose data is mapped into memory,
+ * so windows of samples can be taken from anywhere in it without reading the file again.
+ */
+typedef struct sound_handle
+{
+	FileInfo info;
+	void *map;					/*The whole file*/
+	size_t map_size;
+	const unsigned char *data;	/*Where the samples start in the map*/
+	unsigned num_values;		/*Values in the data, counting both channels of stereo files*/
+} SoundHandle;
+
+/**
+ * Opens the file, parses its header and maps it into memory.  Returns NULL if the file can't
+ * be opened or mapped, or if the header isn't valid.
+ */
+SoundHandlePtr handle_open(const char *file_name);
+
+/**
+ * Unmaps the file and frees the handle.
+ */
+void handle_close(SoundHandlePtr handle);
+
+/**
+ * Fills "samples" the same way fill_samples in fourier.h does: "number" values starting
+ * "start" percent of the way into the file, and then the sample rate.  Returns the number of
+ * values that were in the file, which is less than "number" if the file is too short.
+ */
+int handle_read(SoundHandlePtr handle, int number, int start, int *samples);
+
+#endif
@@ -1,69 +1,259 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "input_lib.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include "info_lib.h"
+#include "perf_lib.h"
+#include "pool_lib.h"
+
+/*Output formats*/
+#define FORMAT_TEXT 0
+#define FORMAT_JSON 1
+#define FORMAT_CSV 2
+
+/**
+ * The list of files shared by the pool's threads.
+ */
+typedef struct job_list
+{
+	InfoJobPtr jobs;
+	int num_jobs;
+	int capacity;
+	int trust;			/*Use the header statistics instead of reading the data when possible*/
+} JobList;
+
+void add_path(JobList *list, const char *path);
+int compare_names(const void *a, const void *b);
+void check_files(void *arg, int from, int to);
 
 /**
  * Part B: Info
  * Checks if a sound file provided is in the proper format.  If it is, various pieces of
  * information about the file are output.  A filename can be provided as a command line
- * parameter, but if it is not, then the input is taken from standard input.
+ * parameter, but if it is not, then the input is taken from standard input.  While the data
+ * is being checked, the peak, RMS level, DC offset, clipping and range of each channel are
+ * worked out in the same pass and output after the header information.
+ *
+ * Any number of files and directories can be given.  Directories are searched for files,
+ * including in their subdirectories.  The files are checked in parallel by the thread pool
+ * and the results are output in the order the files were found.  With -json each file gets a
+ * JSON object on its own line, and with -csv each file gets one row after a row of column
+ * names.
+ *
+ * If a file's header has PEAK, RMS or CHECKSUM fields they are checked against the data, and
+ * the file is invalid if they don't match.  With -trust, files whose header has all three and
+ * the number of samples are not read at all; the header's statistics are reported instead.
  *
- * Command Line Variables: file name (optional)
+ * Command Line Variables: info [-json | -csv] [-trust] [-j threads] [file or directory ...]
  * Return Values: 0 - Success; 1 - Failure (error written to stderr)
  */
 int main(int argc, char *argv[])
 {
-	char filename[MAX_FILE_NAME_LEN];
-	FILE *inp;
-	FileInfoPtr info = (FileInfoPtr)malloc(sizeof(FileInfo));
-	int ret_val;
+	JobList list;
+	InfoJob stdin_job;
+	int format = FORMAT_TEXT;
+	int paths_given = 0;
+	int num_printed = 0;
+	int ret_val = 0;
+	int i;
+
+	perf_init(&argc, argv);
 	
-	if(argc > 1)
+	list.num_jobs = 0;
+	list.capacity = 64;
+	list.trust = 0;
+	list.jobs = (InfoJobPtr)perf_malloc(list.capacity * sizeof(InfoJob));
+
+	for(i=1; i<argc; i++)
 	{
-		strncpy(filename, argv[1], MAX_FILE_NAME_LEN);
-		if((inp = fopen(filename, "r")) == NULL)
+		if(strcmp(argv[i], "-json") == 0)
+		{
+			format = FORMAT_JSON;
+		}
+		else if(strcmp(argv[i], "-csv") == 0)
+		{
+			format = FORMAT_CSV;
+		}
+		else if(strcmp(argv[i], "-trust") == 0)
+		{
+			list.trust = 1;
+		}
+		else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			pool_init(atoi(argv[++i]));
+		}
+		else
 		{
-			fprintf(stderr, "Cannot open: %s\n", filename);
-			free(info);
-			return 1;
+			add_path(&list, argv[i]);
+			paths_given = 1;
 		}
-		strncpy(info->file_name, filename, MAX_FILE_NAME_LEN);
 	}
-	else
+
+	if(format == FORMAT_CSV)
 	{
-		inp = stdin;
-		strncpy(info->file_name, "stdin", 5);
+		info_print_csv_header(stdout);
 	}
-	/*The handle_input call does most of the work in checking data format etc.*/
-	ret_val = handle_input(inp, info, NONE);
-	/*Output the required information about the file if the file is valid*/
-	if(ret_val == 0)
+
+	/*With no files the input is taken from standard input*/
+	if(!paths_given)
 	{
-		/*It was said on WebCT that we shouldn't output a filename if input is stdin.*/
-		if(strncmp(info->file_name, "stdin", 5) != 0)
+		stdin_job.path = "stdin";
+		stdin_job.valid = (info_analyze(stdin, &stdin_job, list.trust) == 0);
+		strncpy(stdin_job.info.file_name, "stdin", MAX_FILE_NAME_LEN);
+		if(format == FORMAT_JSON)
 		{
-			printf("Filename: %s\n", info->file_name);
+			info_print_json(stdout, &stdin_job);
 		}
-		
-		printf("Frequency: %d\n", info->frequency);
-		if(info->mono_or_stereo == MONO)
+		else if(format == FORMAT_CSV)
 		{
-			printf("Channels: MONO\n");
+			info_print_csv(stdout, &stdin_job);
 		}
-		else
+		else if(stdin_job.valid)
 		{
-			printf("Channels: STEREO\n");
+			/*It was said on WebCT that we shouldn't output a filename if input is stdin.*/
+			info_print_text(stdout, &stdin_job, 0);
 		}
-		printf("Bits per sample: %d\n", info->bit_size);
-		printf("Number of samples: %d\n", info->num_samples);
+		free(list.jobs);
+		return stdin_job.valid ? 0 : 1;
 	}
-	
-	/*Close the file if needed*/
-	if(argc > 1)
+
+	/*One file at a time, since they can be very different sizes*/
+	pool_parallel_for(0, list.num_jobs, 1, check_files, &list);
+
+	for(i=0; i<list.num_jobs; i++)
 	{
-		fclose(inp);
+		if(format == FORMAT_JSON)
+		{
+			info_print_json(stdout, &list.jobs[i]);
+		}
+		else if(format == FORMAT_CSV)
+		{
+			info_print_csv(stdout, &list.jobs[i]);
+		}
+		else if(list.jobs[i].valid)
+		{
+			/*Blank line between files*/
+			if(num_printed++ > 0)
+			{
+				printf("\n");
+			}
+			info_print_text(stdout, &list.jobs[i], 1);
+		}
+		if(!list.jobs[i].valid)
+		{
+			ret_val = 1;
+		}
+		free(list.jobs[i].path);
 	}
-	free(info);
+	free(list.jobs);
 	return ret_val;
 }
+
+/**
+ * Adds a file to the list.  If the path is a directory, every file in it and its
+ * subdirectories is added instead, in alphabetical order.  Symbolic links to directories
+ * inside the walk are skipped, so a link back up the tree can't loop.
+ */
+void add_path(JobList *list, const char *path)
+{
+	struct stat info;
+	struct stat link_info;
+	DIR *dir;
+	struct dirent *entry;
+	char **names;
+	char *child;
+	int num_names = 0;
+	int capacity = 64;
+	int i;
+
+	if(stat(path, &info) == 0 && S_ISDIR(info.st_mode))
+	{
+		if((dir = opendir(path)) == NULL)
+		{
+			fprintf(stderr, "Cannot open: %s\n", path);
+			return;
+		}
+		names = (char**)perf_malloc(capacity * sizeof(char*));
+		while((entry = readdir(dir)) != NULL)
+		{
+			if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			{
+				continue;
+			}
+			if(num_names == capacity)
+			{
+				capacity = capacity * 2;
+				names = (char**)perf_realloc(names, capacity * sizeof(char*));
+			}
+			names[num_names++] = strdup(entry->d_name);
+		}
+		closedir(dir);
+
+		qsort(names, num_names, sizeof(char*), compare_names);
+		for(i=0; i<num_names; i++)
+		{
+			child = (char*)perf_malloc(strlen(path) + strlen(names[i]) + 2);
+			sprintf(child, "%s/%s", path, names[i]);
+			if(!(lstat(child, &link_info) == 0 && S_ISLNK(link_info.st_mode) &&
+					stat(child, &info) == 0 && S_ISDIR(info.st_mode)))
+			{
+				add_path(list, child);
+			}
+			free(child);
+			free(names[i]);
+		}
+		free(names);
+		return;
+	}
+
+	if(list->num_jobs == list->capacity)
+	{
+		list->capacity = list->capacity * 2;
+		list->jobs = (InfoJobPtr)perf_realloc(list->jobs, list->capacity * sizeof(InfoJob));
+	}
+	list->jobs[list->num_jobs].path = strdup(path);
+	list->jobs[list->num_jobs].valid = 0;
+	list->jobs[list->num_jobs].trusted = 0;
+	list->num_jobs++;
+}
+
+/**
+ * qsort comparison for file names.
+ */
+int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * Pool function.  Checks files "from" to "to" of the list.
+ */
+void check_files(void *arg, int from, int to)
+{
+	JobList *list = (JobList*)arg;
+	InfoJobPtr job;
+	FILE *inp;
+	int next;
+
+	for(next=from; next<to; next++)
+	{
+		job = &list->jobs[next];
+		strncpy(job->info.file_name, job->path, MAX_FILE_NAME_LEN - 1);
+		job->info.file_name[MAX_FILE_NAME_LEN - 1] = '\0';
+		if((inp = fopen(job->path, "r")) == NULL)
+		{
+			fprintf(stderr, "Cannot open: %s\n", job->path);
+			continue;
+		}
+		if(info_analyze(inp, job, list->trust) == 0)
+		{
+			job->valid = 1;
+		}
+		else
+		{
+			fprintf(stderr, "Not a valid sound file: %s\n", job->path);
+		}
+		fclose(inp);
+	}
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include "info_lib.h"
+
+static void print_header_stats(FILE *out, FileInfoPtr info);
+static void print_channel_stats(FILE *out, SignalStatsPtr stats, int channel,
+								const char *name);
+static void print_quoted(FILE *out, const char *str, int csv);
+
+/**
+ * Checks one file and collects its statistics.  The header is checked by parse_header, and
+ * the data is checked while the statistics are collected.  If "trust" is set and the header
+ * has everything, the data isn't read.  Returns 0 if the file is valid.
+ */
+int info_analyze(FILE *inp, InfoJobPtr job, int trust)
+{
+	job->trusted = 0;
+	if(parse_header(inp, &job->info, NONE) != 0)
+	{
+		return 1;
+	}
+	if(trust && job->info.header_stats == HEADER_ALL_STATS && job->info.num_samples != 0)
+	{
+		job->trusted = 1;
+		return 0;
+	}
+	if(parse_file_stats(inp, &job->info, &job->stats) != 0)
+	{
+		return 1;
+	}
+	if(check_header_stats(&job->stats, &job->info) != 0)
+	{
+		fprintf(stderr, "The statistics in the header do not match the data.\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Outputs the information about a valid file as text.  See info_lib.h.
+ */
+void info_print_text(FILE *out, InfoJobPtr job, int show_name)
+{
+	FileInfoPtr info = &job->info;
+
+	if(show_name)
+	{
+		fprintf(out, "Filename: %s\n", job->path);
+	}
+	fprintf(out, "Frequency: %d\n", info->frequency);
+	if(info->mono_or_stereo == MONO)
+	{
+		fprintf(out, "Channels: MONO\n");
+	}
+	else
+	{
+		fprintf(out, "Channels: STEREO\n");
+	}
+	fprintf(out, "Bits per sample: %d\n", info->bit_size);
+	fprintf(out, "Number of samples: %d\n", info->num_samples);
+	print_header_stats(out, info);
+	if(info->num_samples > 0 && !job->trusted)
+	{
+		if(info->mono_or_stereo == MONO)
+		{
+			print_channel_stats(out, &job->stats, 0, "Channel");
+		}
+		else
+		{
+			print_channel_stats(out, &job->stats, 0, "Left channel");
+			print_channel_stats(out, &job->stats, 1, "Right channel");
+		}
+	}
+}
+
+/**
+ * Outputs the statistics that were in the header, for all the channels together.
+ */
+static void print_header_stats(FILE *out, FileInfoPtr info)
+{
+	if(info->header_stats & HEADER_PEAK)
+	{
+		fprintf(out, "Header peak: %u\n", info->peak);
+	}
+	if(info->header_stats & HEADER_RMS)
+	{
+		fprintf(out, "Header RMS: %.2f\n", info->rms);
+	}
+	if(info->header_stats & HEADER_CHECKSUM)
+	{
+		fprintf(out, "Header checksum: %08x\n", info->checksum);
+	}
+}
+
+/**
+ * Outputs the statistics for one channel.  Levels are distances from the channel's mean (its
+ * DC offset), and are also given in dB relative to full scale.  See signal_lib.h.
+ */
+static void print_channel_stats(FILE *out, SignalStatsPtr stats, int channel,
+								const char *name)
+{
+	unsigned peak = stats_peak(stats, channel);
+	double rms = stats_rms(stats, channel);
+
+	fprintf(out, "%s min: %u\n", name, stats->channel[channel].min);
+	fprintf(out, "%s max: %u\n", name, stats->channel[channel].max);
+	if(peak > 0)
+	{
+		fprintf(out, "%s peak: %u (%.2f dBFS)\n", name, peak, stats_dbfs(stats, peak));
+		fprintf(out, "%s RMS: %.2f (%.2f dBFS)\n", name, rms, stats_dbfs(stats, rms));
+	}
+	else
+	{
+		fprintf(out, "%s peak: 0 (silent)\n", name);
+		fprintf(out, "%s RMS: 0.00 (silent)\n", name);
+	}
+	fprintf(out, "%s DC offset: %.2f\n", name, stats_dc_offset(stats, channel));
+	fprintf(out, "%s clipped samples: %llu low, %llu high\n", name,
+				stats_clipped_low(stats, channel), stats->channel[channel].clipped_high);
+}
+
+/**
+ * Outputs one file as a JSON object on a single line.  Invalid files only get their name.
+ */
+void info_print_json(FILE *out, InfoJobPtr job)
+{
+	FileInfoPtr info = &job->info;
+	SignalStatsPtr stats = &job->stats;
+	int channels, c;
+
+	fprintf(out, "{\"file\": ");
+	print_quoted(out, job->path, 0);
+	if(!job->valid)
+	{
+		fprintf(out, ", \"valid\": false}\n");
+		return;
+	}
+	channels = (info->mono_or_stereo == STEREO) ? 2 : 1;
+	fprintf(out, ", \"valid\": true, \"frequency\": %d, \"channels\": \"%s\", \"bits\": %d, ",
+				info->frequency, (channels == 2) ? "STEREO" : "MONO", info->bit_size);
+	fprintf(out, "\"samples\": %u, ", info->num_samples);
+	if(info->header_stats & HEADER_PEAK)
+	{
+		fprintf(out, "\"header_peak\": %u, ", info->peak);
+	}
+	if(info->header_stats & HEADER_RMS)
+	{
+		fprintf(out, "\"header_rms\": %.2f, ", info->rms);
+	}
+	if(info->header_stats & HEADER_CHECKSUM)
+	{
+		fprintf(out, "\"header_checksum\": \"%08x\", ", info->checksum);
+	}
+	fprintf(out, "\"trusted\": %s, \"stats\": [", job->trusted ? "true" : "false");
+	for(c=0; c<channels && info->num_samples > 0 && !job->trusted; c++)
+	{
+		fprintf(out, "%s{\"min\": %u, \"max\": %u, \"peak\": %u, \"rms\": %.2f, ", (c > 0) ? ", " : "",
+					stats->channel[c].min, stats->channel[c].max, stats_peak(stats, c),
+					stats_rms(stats, c));
+		fprintf(out, "\"dc_offset\": %.2f, \"clipped_low\": %llu, \"clipped_high\": %llu}",
+					stats_dc_offset(stats, c), stats_clipped_low(stats, c),
+					stats->channel[c].clipped_high);
+	}
+	fprintf(out, "]}\n");
+}
+
+/**
+ * Outputs the row of column names for -csv.  Mono files leave the right channel columns
+ * empty.
+ */
+void info_print_csv_header(FILE *out)
+{
+	const char *sides[] = {"left", "right"};
+	int c;
+
+	fprintf(out, "file,valid,frequency,channels,bits,samples");
+	for(c=0; c<2; c++)
+	{
+		fprintf(out, ",%s_min,%s_max,%s_peak,%s_rms,%s_dc_offset,%s_clipped_low,%s_clipped_high",
+					sides[c], sides[c], sides[c], sides[c], sides[c], sides[c], sides[c]);
+	}
+	fprintf(out, ",header_peak,header_rms,header_checksum,trusted\n");
+}
+
+/**
+ * Outputs one file as a row of comma separated values.
+ */
+void info_print_csv(FILE *out, InfoJobPtr job)
+{
+	FileInfoPtr info = &job->info;
+	SignalStatsPtr stats = &job->stats;
+	int channels, c;
+
+	print_quoted(out, job->path, 1);
+	if(!job->valid)
+	{
+		/*Everything after the name and valid columns is empty*/
+		fprintf(out, ",0,,,,%s%s,,,,\n", ",,,,,,,", ",,,,,,,");
+		return;
+	}
+	channels = (info->mono_or_stereo == STEREO) ? 2 : 1;
+	fprintf(out, ",1,%d,%s,%d,%u", info->frequency, (channels == 2) ? "STEREO" : "MONO",
+				info->bit_size, info->num_samples);
+	for(c=0; c<2; c++)
+	{
+		if(c < channels && info->num_samples > 0 && !job->trusted)
+		{
+			fprintf(out, ",%u,%u,%u,%.2f,%.2f,%llu,%llu", stats->channel[c].min,
+						stats->channel[c].max, stats_peak(stats, c), stats_rms(stats, c),
+						stats_dc_offset(stats, c), stats_clipped_low(stats, c),
+						stats->channel[c].clipped_high);
+		}
+		else
+		{
+			fprintf(out, ",,,,,,,");
+		}
+	}
+	if(info->header_stats & HEADER_PEAK)
+	{
+		fprintf(out, ",%u", info->peak);
+	}
+	else
+	{
+		fprintf(out, ",");
+	}
+	if(info->header_stats & HEADER_RMS)
+	{
+		fprintf(out, ",%.2f", info->rms);
+	}
+	else
+	{
+		fprintf(out, ",");
+	}
+	if(info->header_stats & HEADER_CHECKSUM)
+	{
+		fprintf(out, ",%08x", info->checksum);
+	}
+	else
+	{
+		fprintf(out, ",");
+	}
+	fprintf(out, ",%d\n", job->trusted);
+}
+
+/**
+ * Outputs a string in double quotes.  For CSV a quote is doubled; for JSON quotes,
+ * backslashes and control characters are escaped.
+ */
+static void print_quoted(FILE *out, const char *str, int csv)
+{
+	putc('"', out);
+	for(; *str != '\0'; str++)
+	{
+		if(csv)
+		{
+			if(*str == '"')
+			{
+				putc('"', out);
+			}
+			putc(*str, out);
+		}
+		else if(*str == '"' || *str == '\\')
+		{
+			putc('\\', out);
+			putc(*str, out);
+		}
+		else if((unsigned char)*str < 0x20)
+		{
+			fprintf(out, "\\u%04x", (unsigned char)*str);
+		}
+		else
+		{
+			putc(*str, out);
+		}
+	}
+	putc('"', out);
+}
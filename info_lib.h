@@ -0,0 +1,52 @@
+#ifndef INFO_LIB_H_
+#define INFO_LIB_H_
+
+#include <stdio.h>
+#include "input_lib.h"
+#include "signal_lib.h"
+
+typedef struct info_job *InfoJobPtr;
+
+/**
+ * One file to look at and the results of looking at it.
+ */
+typedef struct info_job
+{
+	char *path;
+	int valid;
+	int trusted;		/*1 if the statistics are only the ones from the header*/
+	FileInfo info;
+	SignalStats stats;
+} InfoJob;
+
+/**
+ * Checks one file and collects its statistics.  The header is checked by parse_header, and
+ * the data is checked while the statistics are collected.  If "trust" is set and the header
+ * has all the statistics and the number of samples, the data isn't read and the header's
+ * statistics are used.  Returns 0 if the file is valid.  "valid" and "path" aren't touched.
+ */
+int info_analyze(FILE *inp, InfoJobPtr job, int trust);
+
+/**
+ * Writes the information about a valid file to "out" as text, with its name first if
+ * "show_name" is set.
+ */
+void info_print_text(FILE *out, InfoJobPtr job, int show_name);
+
+/**
+ * Writes one file to "out" as a JSON object on a single line.  Invalid files only get their
+ * name.
+ */
+void info_print_json(FILE *out, InfoJobPtr job);
+
+/**
+ * Writes the row of column names that goes before the info_print_csv rows.
+ */
+void info_print_csv_header(FILE *out);
+
+/**
+ * Writes one file to "out" as a row of comma separated values.
+ */
+void info_print_csv(FILE *out, InfoJobPtr job);
+
+#endif
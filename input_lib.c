@@ -1,5 +1,7 @@
 #include "input_lib.h"
 #include "util.h"
+#include "codec_lib.h"
+#include "perf_lib.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -7,6 +9,13 @@
 #include <limits.h>
 
 #define MAX_LINE_LENGTH 200
+/*Number of samples read at a time by load_samples*/
+#define LOAD_BLOCK 4096
+/*Number of frames converted at a time by split and combine*/
+#define CONVERT_BLOCK 4096
+
+static int parse_header_fields(FILE *inp, FILE *out, FileInfoPtr file_info, int options);
+static int convert_channels(FILE *inp, FileInfoPtr file_info, int options);
 
 /**
  * Handles the input from a given file.  Information about the file is stored in the struct
@@ -21,7 +30,7 @@ int handle_input(FILE *inp, FileInfoPtr file_info, int options)
 	
 	if(file_info == NULL)
 	{
-		file_info = (FileInfoPtr)malloc(sizeof(FileInfo));
+		file_info = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
 		/*We want to free this memory before returning to the caller.*/
 		delete_struct = 1;
 	}
@@ -55,8 +64,32 @@ int handle_input(FILE *inp, FileInfoPtr file_info, int options)
  * is case insensitive.  Once found, it looks through the following fields for parameters.
  * Once "endheader" is found it returns, and leaves the file pointer pointing to the first
  * byte of data in the file.  Returns 0 if no format errors are found and 1 if they are.
+ * The optional PEAK, RMS and CHECKSUM fields are stored in the struct, but they aren't passed
+ * through for split, combine and reverb since those programs change the data.
  */
 int parse_header(FILE *inp, FileInfoPtr file_info, int options)
+{
+	return parse_header_to(inp, stdout, file_info, options);
+}
+
+/**
+ * parse_header, but the header kept for split, combine and reverb is written to "out".
+ */
+int parse_header_to(FILE *inp, FILE *out, FileInfoPtr file_info, int options)
+{
+	unsigned long long start;
+	int result;
+	
+	PERF_START(start);
+	result = parse_header_fields(inp, out, file_info, options);
+	PERF_STOP(PERF_HEADER_NS, "parse_header", start);
+	return result;
+}
+
+/**
+ * Does the work for parse_header_to, which is a wrapper so the time spent here can be counted.
+ */
+static int parse_header_fields(FILE *inp, FILE *out, FileInfoPtr file_info, int options)
 {
 	char next_char;
 	char next_line[MAX_LINE_LENGTH];
@@ -68,6 +101,8 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
 	int cur_index = 0;
 	char *channels;
 	char *next_keyword;
+	char *save_ptr;		/*strtok_r state, so several threads can parse headers at once*/
+	int stats_field;
 	
 	/*Look for "header" keyword.  We must do this character by character because we don't
 	know how many bytes will come before the word "header"*/
@@ -85,7 +120,7 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
 		/*If SPLIT or COMBINE or REVERB we want to keep all header info*/
 		if(options == SPLIT || options == COMBINE || options == REVERB)
 		{
-			putc(next_char, stdout);
+			putc(next_char, out);
 		}
 	}
 	if(cur_index != 6)
@@ -96,30 +131,36 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
 	/*If SPLIT or COMBINE, we need to print a newline after HEADER*/
 	if(options == SPLIT || options == COMBINE || options == REVERB)
 	{
-		putc('\n', stdout);
+		putc('\n', out);
 	}
 	
 	/*By default channels is set to MONO*/
 	file_info->mono_or_stereo = MONO;
 	/*By default number of samples is 0*/
 	file_info->num_samples = 0;
+	/*The statistics are only there if the writer put them there*/
+	file_info->header_stats = 0;
 	
 	/*Parse the rest of the header*/
 	while(fgets(next_line, MAX_LINE_LENGTH, inp) != NULL)
 	{
 		strncpy(next_line_cpy, next_line, MAX_LINE_LENGTH);
-		next_keyword = strtok(next_line, " ");
+		next_keyword = strtok_r(next_line, " ", &save_ptr);
 		/*remove newline*/
 		if(next_line[strlen(next_line)-1]=='\n')
 		{
 			next_line[strlen(next_line)-1] = '\0';
 		}
 		
+		stats_field = (strcasecmp(next_keyword, "PEAK") == 0 ||
+						strcasecmp(next_keyword, "RMS") == 0 ||
+						strcasecmp(next_keyword, "CHECKSUM") == 0);
+		
 		/*If SPLIT or COMBINE or REVERB then we need to print out the header values*/
 		if((options == SPLIT || options == COMBINE || options == REVERB) && 
-								strncasecmp(next_keyword, "CHANNELS", 8) != 0)
+						strncasecmp(next_keyword, "CHANNELS", 8) != 0 && !stats_field)
 		{
-			printf("%s", next_line_cpy);
+			fprintf(out, "%s", next_line_cpy);
 		}
 		
 		if(strncasecmp(next_line, "ENDHEADER", 9) == 0)
@@ -130,24 +171,24 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
 		if(strncasecmp(next_keyword, "FREQUENCY", 9) == 0 &&
 							strlen(next_keyword) == strlen("FREQUENCY"))
 		{
-			file_info->frequency = atoi(strtok(NULL, " "));
+			file_info->frequency = atoi(strtok_r(NULL, " ", &save_ptr));
 			freq_set = 1;
 		}
 		else if(strncasecmp(next_keyword, "SAMPLE", 6) == 0 &&
 							strlen(next_keyword) == strlen("SAMPLE"))
 		{
-			file_info->num_samples = atoi(strtok(NULL, " "));
+			file_info->num_samples = atoi(strtok_r(NULL, " ", &save_ptr));
 		}
 		else if(strncasecmp(next_keyword, "SAMPLEBITS", 10) == 0 &&
 							strlen(next_keyword) == strlen("SAMPLEBITS"))
 		{
-			file_info->bit_size = atoi(strtok(NULL, " "));
+			file_info->bit_size = atoi(strtok_r(NULL, " ", &save_ptr));
 			bit_size_set = 1;
 		}
 		else if(strncasecmp(next_keyword, "CHANNELS", 8) == 0 &&
 							strlen(next_keyword) == strlen("CHANNELS"))
 		{
-			channels = strtok(NULL, " ");
+			channels = strtok_r(NULL, " ", &save_ptr);
 			if(strncmp(channels, "MONO", 4) == 0)
 			{
 				file_info->mono_or_stereo = MONO; 
@@ -166,17 +207,32 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
 			/*Print out the needed header info for split, combine and reverb (channels)*/
 			if(options == SPLIT)
 			{
-				printf("CHANNELS STEREO\n");
+				fprintf(out, "CHANNELS STEREO\n");
 			}
 			else if(options == COMBINE)
 			{
-				printf("CHANNELS MONO\n");
+				fprintf(out, "CHANNELS MONO\n");
 			}
 			else if(options == REVERB)
 			{
-				printf("%s", next_line_cpy);
+				fprintf(out, "%s", next_line_cpy);
 			}
 		}
+		else if(strcasecmp(next_keyword, "PEAK") == 0)
+		{
+			file_info->peak = strtoul(strtok_r(NULL, " ", &save_ptr), NULL, 10);
+			file_info->header_stats |= HEADER_PEAK;
+		}
+		else if(strcasecmp(next_keyword, "RMS") == 0)
+		{
+			file_info->rms = atof(strtok_r(NULL, " ", &save_ptr));
+			file_info->header_stats |= HEADER_RMS;
+		}
+		else if(strcasecmp(next_keyword, "CHECKSUM") == 0)
+		{
+			file_info->checksum = strtoul(strtok_r(NULL, " ", &save_ptr), NULL, 16);
+			file_info->header_stats |= HEADER_CHECKSUM;
+		}
 		else
 		{
 			fprintf(stderr, "Illegal field in the header: \"%s\"\n", next_line);
@@ -226,15 +282,11 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options)
  */
 int parse_file(FILE *inp, FileInfoPtr file_info, int options)
 {
-	unsigned value;
-	unsigned value2;
+	unsigned char bytes[LOAD_BLOCK];
+	int got;
 	int bytes_per_sample;
 	int num_bytes = 0;
 	int num_samples = 0;
-	int end_of_file = 0;
-	
-	int bytes_read = 0;
-	int bytes_read2 = 0;
 	
 	/*Preference to work in bytes rather than bits*/
 	bytes_per_sample = file_info->bit_size / 8;
@@ -246,20 +298,7 @@ int parse_file(FILE *inp, FileInfoPtr file_info, int options)
 			fprintf(stderr, "The \"split\" program can only be run when a mono stream is input.\n");
 			return 1;
 		}
-		while(end_of_file == 0)
-		{
-			if((bytes_read = read_sample(inp, file_info->bit_size, &value)) != 
-																bytes_per_sample)
-			{
-				end_of_file = 1;
-			}
-			else
-			{
-				output_sample(stdout, value, file_info->bit_size);
-				output_sample(stdout, value, file_info->bit_size);
-			}
-			num_bytes = num_bytes + bytes_read;
-		}
+		num_bytes = convert_channels(inp, file_info, SPLIT);
 	}
 	else if(options == COMBINE)
 	{
@@ -268,35 +307,15 @@ int parse_file(FILE *inp, FileInfoPtr file_info, int options)
 			fprintf(stderr, "The \"combine\" program can only be run when a stereo stream is input.\n");
 			return 1;
 		}
-		while(end_of_file == 0)
-		{
-			if((bytes_read = read_sample(inp, file_info->bit_size, &value)) != 
-																bytes_per_sample)
-			{
-				end_of_file = 1;
-			}
-			else
-			{
-				if((bytes_read2 = read_sample(inp, file_info->bit_size, &value2)) != 
-																bytes_per_sample)
-				{
-					end_of_file = 1;
-				}
-				else
-				{
-					output_sample(stdout, (int)(value+value2)/2, file_info->bit_size);
-				}
-				num_bytes = num_bytes + bytes_read2;
-			}
-			num_bytes = num_bytes + bytes_read;
-		}
+		num_bytes = convert_channels(inp, file_info, COMBINE);
 	}
 	else		/*Just parse the file making sure format is valid*/
 	{
-		while((value = getc(inp)) != EOF)
+		while((got = fread(bytes, 1, sizeof(bytes), inp)) > 0)
 		{
-			num_bytes++;
+			num_bytes += got;
 		}
+		perf_add(PERF_BYTES_READ, num_bytes);
 	}
 	
 	if(num_bytes % bytes_per_sample !=0)
@@ -326,3 +345,125 @@ int parse_file(FILE *inp, FileInfoPtr file_info, int options)
 	file_info->num_samples = num_samples;
 	return 0;
 }
+
+/**
+ * Does the work of split and combine.  The data is read a block at a time and written to the
+ * standard output with the other number of channels, using the codec for the input's format so
+ * nothing checks the format for each sample.  Only whole frames are written; any bytes left
+ * over at the end are still counted so parse_file can report them.  Returns the number of
+ * bytes of data that were read.
+ */
+static int convert_channels(FILE *inp, FileInfoPtr file_info, int options)
+{
+	const SampleCodec *codec = codec_get(file_info->bit_size, file_info->mono_or_stereo);
+	int frame_bytes = codec->bytes_per_sample * codec->channels;
+	unsigned char bytes[CONVERT_BLOCK * 8];
+	unsigned samples[CONVERT_BLOCK * 2];
+	unsigned out[CONVERT_BLOCK * 2];
+	int num_bytes = 0;
+	int have = 0;
+	int got, frames;
+	unsigned long long start;
+
+	while(1)
+	{
+		PERF_START(start);
+		got = fread(bytes + have, 1, CONVERT_BLOCK * frame_bytes - have, inp);
+		PERF_STOP(PERF_IO_WAIT_NS, "read_block", start);
+		if(got <= 0)
+		{
+			break;
+		}
+		num_bytes += got;
+		have += got;
+
+		/*A frame split between two reads is kept for the next one*/
+		frames = have / frame_bytes;
+		codec->unpack(bytes, samples, frames * codec->channels);
+		if(options == SPLIT)
+		{
+			codec->to_stereo(samples, out, frames);
+			output_samples(stdout, out, 2 * frames, file_info->bit_size);
+		}
+		else
+		{
+			codec->to_mono(samples, out, frames);
+			output_samples(stdout, out, frames, file_info->bit_size);
+		}
+		perf_add(PERF_SAMPLES_READ, frames * codec->channels);
+		have -= frames * frame_bytes;
+		memmove(bytes, bytes + frames * frame_bytes, have);
+	}
+	perf_add(PERF_BYTES_READ, num_bytes);
+	return num_bytes;
+}
+
+
+/**
+ * Parses the header and then reads all of the data into memory.  Returns a malloc'ed array
+ * holding every value (both channels interleaved if STEREO) and sets num_samples in the
+ * "file_info" struct.  Returns NULL if the file has a format error.
+ */
+unsigned* load_samples(FILE *inp, FileInfoPtr file_info)
+{
+	unsigned *samples;
+	unsigned capacity, used, num_samples;
+	int bytes_per_sample;
+	int bytes_read;
+	unsigned long long start;
+	
+	if(parse_header(inp, file_info, NONE) != 0)
+	{
+		return NULL;
+	}
+	
+	bytes_per_sample = file_info->bit_size / 8;
+	capacity = LOAD_BLOCK;
+	used = 0;
+	samples = (unsigned*)perf_malloc(capacity * sizeof(unsigned));
+	do
+	{
+		if(used + LOAD_BLOCK > capacity)
+		{
+			capacity = capacity * 2;
+			samples = (unsigned*)perf_realloc(samples, capacity * sizeof(unsigned));
+		}
+		/*Read bytes rather than samples so a partial sample at the end can be caught*/
+		PERF_START(start);
+		bytes_read = fread(samples + used, 1, LOAD_BLOCK * bytes_per_sample, inp);
+		PERF_STOP(PERF_IO_WAIT_NS, "read_block", start);
+		perf_add(PERF_BYTES_READ, bytes_read);
+		unpack_samples(samples + used, bytes_read / bytes_per_sample, file_info->bit_size);
+		used += bytes_read / bytes_per_sample;
+	} while(bytes_read == LOAD_BLOCK * bytes_per_sample);
+	perf_add(PERF_SAMPLES_READ, used);
+	
+	/*Same checks as parse_file*/
+	if(bytes_read % bytes_per_sample != 0)
+	{
+		fprintf(stderr, "The number of bytes of data must be evenly divisible by the bytes per sample.\n");
+		free(samples);
+		return NULL;
+	}
+	num_samples = used;
+	if(file_info->mono_or_stereo == STEREO)
+	{
+		if(num_samples % 2 != 0)
+		{
+			fprintf(stderr, "Stereo files must have an even number of samples");
+			free(samples);
+			return NULL;
+		}
+		num_samples = num_samples / 2;
+	}
+	if(file_info->num_samples != 0 && num_samples != file_info->num_samples)
+	{
+		fprintf(stderr, "The number of samples in the file does not match the value in the header.");
+		fprintf(stderr, "Header: %d\nFile: %d", 
+					file_info->num_samples, num_samples);
+		free(samples);
+		return NULL;
+	}
+	file_info->num_samples = num_samples;
+	return samples;
+}
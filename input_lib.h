@@ -12,6 +12,12 @@
 #define STEREO 1
 #define MAX_FILE_NAME_LEN 100
 
+/*Flags for the optional statistics fields in a header*/
+#define HEADER_PEAK 1
+#define HEADER_RMS 2
+#define HEADER_CHECKSUM 4
+#define HEADER_ALL_STATS (HEADER_PEAK | HEADER_RMS | HEADER_CHECKSUM)
+
 typedef struct file_info *FileInfoPtr;
 
 /**
@@ -25,6 +31,13 @@ typedef struct file_info
 	int bit_size;
 	unsigned num_samples;
 	
+	/*Statistics a writer can put in the header so readers don't have to work them out.
+	header_stats says which of them were there.*/
+	int header_stats;
+	unsigned peak;		/*Largest sample value in the data, in any channel*/
+	double rms;			/*RMS distance of all the samples from their channel's mean*/
+	unsigned checksum;	/*Adler-32 of the data bytes*/
+	
 	/*The following only used with mix*/
 	double rel_gain;
 } FileInfo;
@@ -43,9 +56,17 @@ int handle_input(FILE *inp, FileInfoPtr file_info, int options);
  * is case insensitive.  Once found, it looks through the following fields for parameters.
  * Once "endheader" is found it returns, and leaves the file pointer pointing to the first
  * byte of data in the file.  Returns 0 if no format errors are found and 1 if they are.
+ * The optional PEAK, RMS and CHECKSUM fields are stored in the struct, but they aren't passed
+ * through for split, combine and reverb since those programs change the data.
  */
 int parse_header(FILE *inp, FileInfoPtr file_info, int options);
 
+/**
+ * The same as parse_header, but the header kept for split, combine and reverb is written to
+ * "out" instead of standard output.
+ */
+int parse_header_to(FILE *inp, FILE *out, FileInfoPtr file_info, int options);
+
 /**
  * Parses through the data portion of the input.  Behavior is very dependent on the options
  * argument.  The error checking at the end of the file is done in all situations.
@@ -57,4 +78,11 @@ int parse_header(FILE *inp, FileInfoPtr file_info, int options);
  */
 int parse_file(FILE *inp, FileInfoPtr file_info, int options);
 
+/**
+ * Parses the header and then reads all of the data into memory.  Returns a malloc'ed array
+ * holding every value (both channels interleaved if STEREO) and sets num_samples in the
+ * "file_info" struct.  Returns NULL if the file has a format error.
+ */
+unsigned* load_samples(FILE *inp, FileInfoPtr file_info);
+
 #endif
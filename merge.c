@@ -2,27 +2,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include "input_lib.h"
+#include "signal_lib.h"
 #include "util.h"
+#include "perf_lib.h"
 
 #define MILLSEC_TO_SEC .001
 
 void print_delay(int pause, int bit_size);
-void print_merge_header(int sample_freq, int mono_stereo, int bit_size);
+void print_merge_header(FileInfoPtr *input_info, FILE **files, int num_files, int pause);
 
 /**
  * This program accepts any number of files and merges them together.  Since this program is
  * only meant to be used as a helper to the gendtmf2.sh shell script, I'm assuming that all 
- * files have the same sample rate, bit-size, and channels.
+ * files have the same sample rate, bit-size, and channels.  The header has the PEAK, RMS and
+ * CHECKSUM of the merged data, which means reading through the files once before merging them.
  */
 int main(int argc, char *argv[])
 {
 	int i, num_files, inp_error;
 	unsigned value;
-    int pause = atoi(argv[1]);
+    int pause;
     
     FileInfoPtr *input_info;		/*Pointer to pointer to file_info struct*/
 	FILE **files;
     
+    perf_init(&argc, argv);
+    
     if(argc < 3)
     {
     		fprintf(stderr, "You must supply the pause duration ");
@@ -30,17 +35,19 @@ int main(int argc, char *argv[])
     		return 1;
     }
     
+    pause = atoi(argv[1]);
     num_files = (argc - 2);	/*-2 gets rid of command input and pause length*/	
-	input_info = (FileInfoPtr*)malloc(num_files * sizeof(FileInfoPtr));
+	input_info = (FileInfoPtr*)perf_malloc(num_files * sizeof(FileInfoPtr));
 	for(i=0; i<num_files; i++)
 	{
-		input_info[i] = (FileInfoPtr)malloc(sizeof(FileInfo));
+		input_info[i] = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
 	}	
-	files = (FILE**)malloc(num_files * sizeof(FILE*));
+	files = (FILE**)perf_malloc(num_files * sizeof(FILE*));
     /*Open all the files and parse each header to get the file pointer to the desired point*/
 	for(i=0; i<num_files; i++)
 	{
-		strncpy(input_info[i]->file_name, argv[2 + i], MAX_FILE_NAME_LEN);
+		strncpy(input_info[i]->file_name, argv[2 + i], MAX_FILE_NAME_LEN - 1);
+		input_info[i]->file_name[MAX_FILE_NAME_LEN - 1] = '\0';
 		if((files[i] = fopen(argv[2 + i], "r")) == NULL)
 		{
 			fprintf(stderr, "Cannot open: %s\n", argv[2 + i]);
@@ -66,12 +73,11 @@ int main(int argc, char *argv[])
 		}
 	}
     
-    /*Print the header from the first file, since we know they will all have the same info*/
-    print_merge_header(input_info[0]->frequency, input_info[0]->mono_or_stereo, 
-    					input_info[0]->bit_size);
-	
 	/*Convert the "pause" variable to samples rather than ms*/
 	pause = pause*MILLSEC_TO_SEC*(input_info[0]->frequency);
+	
+    /*Print the header from the first file, since we know they will all have the same info*/
+    print_merge_header(input_info, files, num_files, pause);
 	    					
     	/*Print the data from the first file*/
     	while((value = getc(files[0]))!= EOF)
@@ -111,22 +117,43 @@ int main(int argc, char *argv[])
 
 /*
  * Prints the header information.  This is specific to this merge program since the number of
- * samples will not be put in the header.
+ * samples will not be put in the header.  The statistics are worked out by reading the data of
+ * all the files, with the pauses in between, and then each file is set back to the start of
+ * its data.
  */
-void print_merge_header(int sample_freq, int mono_stereo, int bit_size)
+void print_merge_header(FileInfoPtr *input_info, FILE **files, int num_files, int pause)
 {
-	printf("Header\n");
-	printf("FREQUENCY %d\n", sample_freq);
-	if(mono_stereo == MONO)
-	{
-		printf("CHANNELS MONO\n");
-	}
-	else
+	FileInfo header = *input_info[0];
+	SignalStats stats;
+	unsigned samples[SIGNAL_BLOCK];
+	int i, count;
+	
+	stats_init(&stats, 1, header.bit_size);
+	for(i=0; i<num_files; i++)
 	{
-		printf("CHANNELS STEREO\n");
+		/*The pause is all 0's, the same as print_delay*/
+		if(i > 0)
+		{
+			for(count=0; count<SIGNAL_BLOCK; count++)
+			{
+				samples[count] = 0;
+			}
+			for(count=pause; count>0; count-=SIGNAL_BLOCK)
+			{
+				stats_add(&stats, samples, (count > SIGNAL_BLOCK) ? SIGNAL_BLOCK : count);
+			}
+		}
+		while((count = read_samples(files[i], input_info[i]->bit_size, samples,
+										SIGNAL_BLOCK)) > 0)
+		{
+			stats_add(&stats, samples, count);
+		}
+		rewind(files[i]);
+		parse_header(files[i], input_info[i], NONE);
 	}
-	printf("SAMPLEBITS %d\n", bit_size);
-	printf("EndHeader\n");
+	
+	stats_to_header(&stats, &header);
+	write_stats_header(stdout, &header, 0);
 }
 
 /*
@@ -134,9 +161,14 @@ void print_merge_header(int sample_freq, int mono_stereo, int bit_size)
  */
 void print_delay(int pause, int bit_size)
 {
+	unsigned zeros[SIGNAL_BLOCK];
 	int i;
-	for(i=0; i<pause; i++)
+	for(i=0; i<SIGNAL_BLOCK; i++)
+	{
+		zeros[i] = 0;
+	}
+	for(i=pause; i>0; i-=SIGNAL_BLOCK)
 	{
-		output_sample(stdout, 0, bit_size);
+		output_samples(stdout, zeros, (i > SIGNAL_BLOCK) ? SIGNAL_BLOCK : i, bit_size);
 	}
 }
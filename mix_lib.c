@@ -0,0 +1,315 @@
+#include "mix_lib.h"
+#include "util.h"
+#include "signal_lib.h"
+#include "resample_lib.h"
+#include "perf_lib.h"
+#include "probes.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*Number of samples of each file added in at a time*/
+#define MIX_BLOCK 4096
+
+static int check_file_info(FileInfoPtr input_info[], int num_files);
+
+/**
+ * Opens, checks and mixes the files.  See mix_lib.h.  Every file that was opened is closed
+ * again however it ends, so this can be called over and over by a long running program.
+ */
+int mix_paths(const char *paths[], const double gains[], int num_files, FILE *out)
+{
+	int result = 0;
+	int num_open = 0;
+	int from_headers = 1;
+	int i;
+	FileInfoPtr *input_info;		/*Pointer to pointer to file_info struct*/
+	FILE **files;
+	unsigned **converted;		/*Resampled data, NULL if the file is already at the right rate*/
+	unsigned num_frames;
+	unsigned num_samples;
+	
+	input_info = (FileInfoPtr*)perf_malloc(num_files * sizeof(FileInfoPtr));
+	files = (FILE**)perf_malloc(num_files * sizeof(FILE*));
+	converted = (unsigned**)perf_calloc(num_files, sizeof(unsigned*));
+	for(i=0; i<num_files; i++)
+	{
+		input_info[i] = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
+	}
+	
+	/*Open all the files and set the relative gains in the file_info structs*/
+	for(i=0; i<num_files && result == 0; i++)
+	{
+		strncpy(input_info[i]->file_name, paths[i], MAX_FILE_NAME_LEN - 1);
+		input_info[i]->file_name[MAX_FILE_NAME_LEN - 1] = '\0';
+		if((files[i] = fopen(paths[i], "r")) == NULL)
+		{
+			fprintf(stderr, "Cannot open: %s\n", paths[i]);
+			result = 1;
+			break;
+		}
+		num_open++;
+		input_info[i]->rel_gain = gains[i];
+	}
+	
+	/*If every header has the PEAK and SAMPLE fields the data doesn't have to be read through
+	first: mix_files takes its scale from the peaks and checks that each file has as many
+	samples as its header says while it mixes.  Otherwise handle_input checks all the data.*/
+	for(i=0; i<num_files && result == 0; i++)
+	{
+		result = parse_header(files[i], input_info[i], NONE);
+		if(!(input_info[i]->header_stats & HEADER_PEAK) || input_info[i]->num_samples == 0)
+		{
+			from_headers = 0;
+		}
+	}
+	for(i=0; i<num_files && result == 0 && !from_headers; i++)
+	{
+		rewind(files[i]);
+		result = handle_input(files[i], input_info[i], NONE);
+	}
+	
+	/*using the info in the file_info structs, make sure everything is legal*/
+	if(result == 0)
+	{
+		result = check_file_info(input_info, num_files);
+	}
+	
+	for(i=0; i<num_files && result == 0; i++)
+	{
+		/*Reset the file pointers to the beginning of the files*/
+		rewind(files[i]);
+		
+		/*Call parse_header on each file to get the file pointers to the data.  It clears the
+		number of samples, so keep the count handle_input found for files with no SAMPLE field*/
+		num_samples = input_info[i]->num_samples;
+		parse_header(files[i], input_info[i], NONE);
+		input_info[i]->num_samples = num_samples;
+		
+		/*Any file at a different rate is converted to the rate of the first file*/
+		if(input_info[i]->frequency != input_info[0]->frequency)
+		{
+			converted[i] = resample_file(files[i], input_info[i], input_info[0]->frequency,
+											&num_frames);
+			if(converted[i] == NULL)
+			{
+				result = 1;
+			}
+		}
+	}
+	
+	if(result == 0)
+	{
+		result = mix_files(input_info, files, converted, num_files, out);
+	}
+	
+	/*Close all the files and free all the needed memory*/
+	for(i=0; i<num_open; i++)
+	{
+		fclose(files[i]);
+	}
+	for(i=0; i<num_files; i++)
+	{
+		free(input_info[i]);
+		free(converted[i]);
+	}
+	free(input_info);
+	free(files);
+	free(converted);
+	return result;
+}
+
+/**
+ * Does the actual mixing of the files as described in the description of this whole program.
+ * Outputs the header and the final values to "out".  The header is output once the whole
+ * mix is done, since it has the statistics of the mix in it.  If converted[j] is not NULL
+ * then the samples for file j are taken from it rather than read from the file.
+ * If every file's header has its PEAK, the scale comes from the largest the mix could be, the
+ * sum of the peaks times their gains, rather than from a search of the mix.  That can come out
+ * a little quieter when the peaks don't line up, but it never clips.
+ * Note: Jim said that it was ok to ignore overflow in this case, so that's what I've done.
+ */
+int mix_files(FileInfoPtr input_info[], FILE **files, unsigned **converted, int num_files,
+					FILE *out)
+{
+	unsigned num_samples = input_info[0]->num_samples;
+	unsigned *samples;
+	unsigned i;
+	unsigned j;
+	unsigned k, n, got;
+	unsigned block[MIX_BLOCK];
+	const unsigned *to_add;
+	double gain;
+	unsigned max_sample;
+	double max_bound = 0.0;
+	int use_peaks = 1;
+	double scale_factor;
+	FileInfo header;
+	SignalStats stats;
+	unsigned long long perf_start;
+	
+	/*The largest each file can add, from its header or from the converted samples*/
+	for(j=0; j<num_files && use_peaks; j++)
+	{
+		gain = input_info[j]->rel_gain;
+		use_peaks = (gain >= 0.0 && (input_info[j]->header_stats & HEADER_PEAK));
+		max_sample = input_info[j]->peak;
+		if(converted[j] != NULL)
+		{
+			max_sample = 0;
+			for(i=0; i<num_samples; i++)
+			{
+				max_sample = (converted[j][i] > max_sample) ? converted[j][i] : max_sample;
+			}
+		}
+		max_bound += floor(max_sample * gain);
+	}
+	
+	samples = (unsigned*)perf_malloc(num_samples * sizeof(unsigned));
+	
+	/*Fill the array with the weighted sums, a block at a time.  Each file's block is read in
+	one go and then added in, so the inner loop is the same for every format.  A file that
+	runs out early has fewer samples than its header says, which is only found here when the
+	data wasn't read through first.*/
+	for(i=0; i<num_samples; i+=MIX_BLOCK)
+	{
+		n = num_samples - i;
+		if(n > MIX_BLOCK)
+		{
+			n = MIX_BLOCK;
+		}
+		for(k=0; k<n; k++)
+		{
+			samples[i+k] = 0;
+		}
+		for(j=0; j<num_files; j++)
+		{
+			if(converted[j] != NULL)
+			{
+				to_add = converted[j] + i;
+			}
+			else
+			{
+				got = read_samples(files[j], input_info[j]->bit_size, block, n);
+				if(got < n)
+				{
+					fprintf(stderr, "%s has fewer samples than its header says.\n",
+								input_info[j]->file_name);
+					free(samples);
+					return 1;
+				}
+				to_add = block;
+			}
+			gain = input_info[j]->rel_gain;
+			PERF_START(perf_start);
+			for(k=0; k<n; k++)
+			{
+				samples[i+k] += (int)(to_add[k]*gain);
+			}
+			PERF_STOP(PERF_COMPUTE_NS, "mix", perf_start);
+		}
+		perf_add(PERF_SAMPLES_PROCESSED, (unsigned long long)n * num_files);
+		SOUND_PROBE2(mix_block, i, n);
+	}
+	
+	PERF_START(perf_start);
+	
+	/*Find the max and use this to find the scaling factor*/
+	if(use_peaks)
+	{
+		max_sample = (unsigned)max_bound;
+	}
+	else
+	{
+		max_sample = 0;
+		for(i=0; i<num_samples; i++)
+		{
+			if(max_sample < samples[i])
+			{
+				max_sample = samples[i];
+			}
+		}
+	}
+	scale_factor = ((pow(2, input_info[0]->bit_size))-1) / (double)max_sample;
+	scale_factor = scale_factor * 0.9;
+	
+	/*Scale the whole array*/
+	for(i=0; i<num_samples; i++)
+	{
+		samples[i] = (unsigned)(samples[i] * scale_factor);
+	}
+	PERF_STOP(PERF_COMPUTE_NS, "scale", perf_start);
+	
+	/*Print out the header info (should be able to use any one of the structs) and the mix*/
+	header = *input_info[0];
+	stats_init(&stats, 1, header.bit_size);
+	stats_add(&stats, samples, num_samples);
+	stats_to_header(&stats, &header);
+	write_stats_header(out, &header, 1);
+	output_samples(out, samples, num_samples, input_info[0]->bit_size);
+	
+	/*Release the memory used for the array*/
+	free(samples);
+	return 0;
+}
+
+/**
+ * Makes sure that all the files are valid and can be mixed together.  Returns 0 if they are
+ * legal and 1 if they are not.
+ */
+static int check_file_info(FileInfoPtr input_info[], int num_files)
+{
+	int i;
+	int m_s;
+	int bit_size;
+	int sample_rate;
+	int num_samples;
+	int file_samples;
+	
+	/*Use the properties of the first file to check that all the other files are the same*/
+	m_s = input_info[0]->mono_or_stereo;
+	bit_size = input_info[0]->bit_size;
+	sample_rate = input_info[0]->frequency;
+	num_samples = input_info[0]->num_samples;
+	
+	/*Loop through each of the remaining files*/
+	for(i=1; i<num_files; i++)
+	{
+		/*Check that all files are either MONO or STEREO, not a mix of both*/
+		if(input_info[i]->mono_or_stereo != m_s)
+		{
+			fprintf(stderr, "All files must be either MONO or STEREO.\n");
+			return 1;
+		}
+		
+		/*Files with a different sample frequency will be resampled, so make sure we can*/
+		if(input_info[i]->frequency != sample_rate && 
+					(input_info[i]->frequency <= 0 || sample_rate <= 0))
+		{
+			fprintf(stderr, "Can't resample %s, its sample rate is 0.\n",
+							input_info[i]->file_name);
+			return 1;
+		}
+		
+		/*Check that all files have the same bit-size*/
+		if(input_info[i]->bit_size != bit_size)
+		{
+			fprintf(stderr, "All files must have the same bit-size.\n");
+			return 1;
+		}
+		
+		/*Check that all files have the same number of samples once they are at the same rate*/
+		file_samples = input_info[i]->num_samples;
+		if(input_info[i]->frequency != sample_rate)
+		{
+			file_samples = resampled_length(file_samples, input_info[i]->frequency,
+											sample_rate);
+		}
+		if(file_samples != num_samples)
+		{
+			fprintf(stderr, "All files must have the same number of samples.\n");
+			return 1;
+		}
+	}
+	return 0;
+}
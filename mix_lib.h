@@ -0,0 +1,26 @@
+#ifndef MIX_LIB_H_
+#define MIX_LIB_H_
+
+#include <stdio.h>
+#include "input_lib.h"
+
+/**
+ * Mixes the files together with their relative gains and scales the result so the largest
+ * value is 0.9*(max possible).  The files must already be pointing at their data.  If
+ * converted[j] is not NULL then the samples for file j are taken from it rather than read
+ * from the file.  If every file's header has its PEAK the scale is worked out from the peaks
+ * instead of the mix.  The header, with the statistics of the mix, and the mixed samples are
+ * written to "out".  Returns 0 on success and 1 if a file has fewer samples than its header
+ * says (error written to stderr), in which case nothing is written.
+ */
+int mix_files(FileInfoPtr input_info[], FILE **files, unsigned **converted, int num_files,
+					FILE *out);
+
+/**
+ * Does everything the mix program does: opens the files, checks that they can be mixed,
+ * resamples any at a different rate than the first one and mixes them with their gains into
+ * "out".  Returns 0 on success and 1 on failure (error written to stderr).
+ */
+int mix_paths(const char *paths[], const double gains[], int num_files, FILE *out);
+
+#endif
@@ -0,0 +1,35 @@
+#include "noise_lib.h"
+
+/*2^64 divided by the golden ratio, the spacing between SplitMix64 states*/
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+/**
+ * Returns the random 64-bit value at position "index" of the stream for "seed".  This is a
+ * counter-based generator (the SplitMix64 output function), so any part of the stream can be
+ * made without making the parts before it.  That lets threads fill different pieces of the
+ * output and still get exactly the same result as one thread would.
+ */
+unsigned long long noise_value(unsigned long long seed, unsigned long long index)
+{
+	unsigned long long z = seed + (index + 1) * GOLDEN_GAMMA;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Fills "out" with "count" random samples starting at position "start" of the stream for
+ * "seed".  Each sample is uniform over the whole range for the bit size, 0 to 2^bit_size-1.
+ */
+void noise_fill(unsigned long long seed, unsigned long long start, unsigned *out, int count,
+					int bit_size)
+{
+	int i;
+	int shift = 64 - bit_size;
+	
+	/*The top bits of the mix are the best ones, so those are the ones we keep*/
+	for(i=0; i<count; i++)
+	{
+		out[i] = (unsigned)(noise_value(seed, start + i) >> shift);
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef NOISE_LIB_H_
+#define NOISE_LIB_H_
+
+/**
+ * Returns the random 64-bit value at position "index" of the stream for "seed".  This is a
+ * counter-based generator (the SplitMix64 output function), so any part of the stream can be
+ * made without making the parts before it.  That lets threads fill different pieces of the
+ * output and still get exactly the same result as one thread would.
+ */
+unsigned long long noise_value(unsigned long long seed, unsigned long long index);
+
+/**
+ * Fills "out" with "count" random samples starting at position "start" of the stream for
+ * "seed".  Each sample is uniform over the whole range for the bit size, 0 to 2^bit_size-1.
+ */
+void noise_fill(unsigned long long seed, unsigned long long start, unsigned *out, int count,
+					int bit_size);
+
+#endif
@@ -0,0 +1,311 @@
+#include "perf_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+/*Number of spans a thread keeps before it writes them to the trace file*/
+#define TRACE_BUFFER_SPANS 4096
+
+typedef struct perf_thread *PerfThreadPtr;
+
+/**
+ * One timed section of code, as it goes in the trace.
+ */
+typedef struct perf_span
+{
+	const char *name;
+	unsigned long long start;
+	unsigned long long end;
+} PerfSpan;
+
+/**
+ * The counters and trace buffer for one thread.  Each thread only adds to its own, so no
+ * locking is needed while the program runs.  They are kept in a list so they can all be added
+ * up at the end, even for threads that have already finished.
+ */
+typedef struct perf_thread
+{
+	unsigned long long value[PERF_NUM_COUNTERS];
+	int tid;
+	int num_spans;
+	PerfSpan *spans;
+	PerfThreadPtr next;
+} PerfThread;
+
+int perf_enabled = 0;
+int perf_tracing = 0;
+
+static const char *counter_names[PERF_NUM_COUNTERS] =
+{
+	"bytes_read", "bytes_written", "samples_read", "samples_written", "samples_processed",
+	"header_parse_ns", "compute_ns", "io_wait_ns", "allocations", "allocated_bytes"
+};
+static _Thread_local PerfThreadPtr this_thread = NULL;
+static _Atomic(PerfThreadPtr) all_threads = NULL;
+static atomic_int next_tid = 1;
+static const char *tool_name = "";
+static unsigned long long start_time;
+
+/*The trace file.  Only one thread writes to it at a time, the one holding trace_lock.*/
+static FILE *trace_file = NULL;
+static atomic_flag trace_lock = ATOMIC_FLAG_INIT;
+static int trace_events = 0;
+static int trace_pid;
+
+static PerfThreadPtr get_thread(void);
+static void trace_flush(PerfThreadPtr thread);
+static void perf_finish(void);
+
+/**
+ * Turns the counters and tracing on if asked to and takes "--stats" and "--trace <file>" out
+ * of the arguments.  See perf_lib.h.
+ */
+void perf_init(int *argc, char *argv[])
+{
+	const char *env = getenv("SOUND_STATS");
+	const char *trace_name = getenv("SOUND_TRACE");
+	const char *slash;
+	int i, j;
+
+	if(env != NULL && env[0] != '\0' && strcmp(env, "0") != 0)
+	{
+		perf_enabled = 1;
+	}
+	for(i=1, j=1; i<*argc; i++)
+	{
+		if(strcmp(argv[i], "--stats") == 0)
+		{
+			perf_enabled = 1;
+		}
+		else if(strcmp(argv[i], "--trace") == 0 && i + 1 < *argc)
+		{
+			trace_name = argv[++i];
+		}
+		else
+		{
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+	argv[j] = NULL;
+
+	if(trace_name != NULL && trace_name[0] != '\0')
+	{
+		if((trace_file = fopen(trace_name, "w")) == NULL)
+		{
+			fprintf(stderr, "Cannot open trace file: %s\n", trace_name);
+		}
+		else
+		{
+			fprintf(trace_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+			trace_pid = getpid();
+			perf_tracing = 1;
+		}
+	}
+
+	if(perf_enabled || perf_tracing)
+	{
+		slash = strrchr(argv[0], '/');
+		tool_name = (slash != NULL) ? slash + 1 : argv[0];
+		start_time = perf_now();
+		/*So the main thread is always the first one in the trace*/
+		get_thread();
+		atexit(perf_finish);
+	}
+}
+
+/**
+ * Adds "amount" to one of the counters for the calling thread.
+ */
+void perf_add(int counter, unsigned long long amount)
+{
+	if(!perf_enabled)
+	{
+		return;
+	}
+	get_thread()->value[counter] += amount;
+}
+
+/**
+ * Allocates and counts it.  See perf_lib.h.
+ */
+void* perf_malloc(size_t size)
+{
+	perf_add(PERF_ALLOCATIONS, 1);
+	perf_add(PERF_ALLOCATED_BYTES, size);
+	return malloc(size);
+}
+
+/**
+ * Allocates zeroed memory and counts it.
+ */
+void* perf_calloc(size_t count, size_t size)
+{
+	perf_add(PERF_ALLOCATIONS, 1);
+	perf_add(PERF_ALLOCATED_BYTES, count * size);
+	return calloc(count, size);
+}
+
+/**
+ * Resizes and counts it as a new allocation.
+ */
+void* perf_realloc(void *ptr, size_t size)
+{
+	perf_add(PERF_ALLOCATIONS, 1);
+	perf_add(PERF_ALLOCATED_BYTES, size);
+	return realloc(ptr, size);
+}
+
+/**
+ * Ends a section of code that was started at "start".  The time is added to "counter" and the
+ * section is put in the calling thread's trace buffer as "name".  The buffer is written to
+ * the trace file when it fills up.
+ */
+void perf_stop(int counter, const char *name, unsigned long long start)
+{
+	unsigned long long end = perf_now();
+	PerfThreadPtr thread = get_thread();
+
+	if(perf_enabled)
+	{
+		thread->value[counter] += end - start;
+	}
+	if(perf_tracing)
+	{
+		if(thread->num_spans == TRACE_BUFFER_SPANS)
+		{
+			trace_flush(thread);
+		}
+		thread->spans[thread->num_spans].name = name;
+		thread->spans[thread->num_spans].start = start;
+		thread->spans[thread->num_spans].end = end;
+		thread->num_spans++;
+	}
+}
+
+/**
+ * The current time in nanoseconds, for timing a section of code.
+ */
+unsigned long long perf_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * Returns the calling thread's counters, making them the first time and adding them to the
+ * front of the list.  They are never freed, so they are still there to be added up after the
+ * thread finishes.
+ */
+static PerfThreadPtr get_thread(void)
+{
+	PerfThreadPtr thread = this_thread;
+
+	if(thread != NULL)
+	{
+		return thread;
+	}
+	thread = (PerfThreadPtr)calloc(1, sizeof(PerfThread));
+	thread->tid = atomic_fetch_add(&next_tid, 1);
+	if(perf_tracing)
+	{
+		thread->spans = (PerfSpan*)malloc(TRACE_BUFFER_SPANS * sizeof(PerfSpan));
+	}
+	thread->next = atomic_load(&all_threads);
+	while(!atomic_compare_exchange_weak(&all_threads, &thread->next, thread))
+	{
+		/*Another thread got in first, thread->next now has the new front so try again*/
+	}
+	this_thread = thread;
+	return thread;
+}
+
+/**
+ * Writes the spans in a thread's buffer to the trace file as complete ("X") events and empties
+ * the buffer.  Times in the trace are in microseconds from when the program started.
+ */
+static void trace_flush(PerfThreadPtr thread)
+{
+	PerfSpan *span;
+	int i;
+
+	while(atomic_flag_test_and_set(&trace_lock))
+	{
+		sched_yield();
+	}
+	for(i=0; i<thread->num_spans; i++)
+	{
+		span = &thread->spans[i];
+		fprintf(trace_file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+					"\"ts\":%.3f,\"dur\":%.3f}\n", (trace_events++ > 0) ? "," : "",
+					span->name, trace_pid, thread->tid, (span->start - start_time) / 1000.0,
+					(span->end - span->start) / 1000.0);
+	}
+	atomic_flag_clear(&trace_lock);
+	thread->num_spans = 0;
+}
+
+/**
+ * Called when the program exits.  Adds up the counters of every thread and prints them to
+ * stderr as one line of JSON, and writes out what's left in the trace buffers along with the
+ * names of the process and its threads.
+ */
+static void perf_finish(void)
+{
+	unsigned long long total[PERF_NUM_COUNTERS];
+	PerfThreadPtr thread;
+	char thread_name[32];
+	int threads = 0;
+	int i;
+
+	memset(total, 0, sizeof(total));
+	for(thread = atomic_load(&all_threads); thread != NULL; thread = thread->next)
+	{
+		for(i=0; i<PERF_NUM_COUNTERS; i++)
+		{
+			total[i] += thread->value[i];
+		}
+		threads++;
+		if(perf_tracing)
+		{
+			trace_flush(thread);
+			if(thread->tid == 1)
+			{
+				strcpy(thread_name, "main");
+			}
+			else
+			{
+				sprintf(thread_name, "worker %d", thread->tid - 1);
+			}
+			fprintf(trace_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+						"\"tid\":%d,\"args\":{\"name\":\"%s\"}}\n",
+						(trace_events++ > 0) ? "," : "", trace_pid, thread->tid, thread_name);
+		}
+	}
+
+	if(perf_tracing)
+	{
+		fprintf(trace_file, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+					"\"args\":{\"name\":\"%s\"}}\n]}\n", (trace_events++ > 0) ? "," : "",
+					trace_pid, tool_name);
+		fclose(trace_file);
+	}
+
+	if(perf_enabled)
+	{
+		/*Worker threads only show up in the list once they've timed or counted something*/
+		fprintf(stderr, "{\"tool\":\"%s\",\"wall_ns\":%llu,\"threads\":%d", tool_name,
+					perf_now() - start_time, threads);
+		for(i=0; i<PERF_NUM_COUNTERS; i++)
+		{
+			fprintf(stderr, ",\"%s\":%llu", counter_names[i], total[i]);
+		}
+		fprintf(stderr, "}\n");
+	}
+}
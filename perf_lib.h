@@ -0,0 +1,68 @@
+#ifndef PERF_LIB_H_
+#define PERF_LIB_H_
+
+#include <stddef.h>
+
+/*The counters that can be added to.  Times are in nanoseconds.*/
+#define PERF_BYTES_READ 0
+#define PERF_BYTES_WRITTEN 1
+#define PERF_SAMPLES_READ 2
+#define PERF_SAMPLES_WRITTEN 3
+#define PERF_SAMPLES_PROCESSED 4
+#define PERF_HEADER_NS 5		/*Parsing headers*/
+#define PERF_COMPUTE_NS 6		/*The actual work of the program*/
+#define PERF_IO_WAIT_NS 7		/*Blocked in fread and fwrite*/
+#define PERF_ALLOCATIONS 8
+#define PERF_ALLOCATED_BYTES 9
+#define PERF_NUM_COUNTERS 10
+
+/*Set by perf_init when counters are being collected and when a trace is being written.
+Everything else does nothing if neither is.*/
+extern int perf_enabled;
+extern int perf_tracing;
+
+/**
+ * Turns the counters on if "--stats" is one of the arguments or the SOUND_STATS environment
+ * variable is set to anything but 0.  Any "--stats" arguments are taken out of argv so the
+ * program's own argument checking doesn't see them.  When the counters are on they are
+ * printed to stderr as one line of JSON when the program exits.
+ *
+ * "--trace <file>" or the SOUND_TRACE environment variable set to a file name writes every
+ * timed section (see PERF_START) to that file as a Chrome trace, which can be opened in
+ * chrome://tracing or ui.perfetto.dev to see where each thread spent its time.  This should
+ * be the first thing main does.
+ */
+void perf_init(int *argc, char *argv[]);
+
+/**
+ * Adds "amount" to one of the counters for the calling thread.
+ */
+void perf_add(int counter, unsigned long long amount);
+
+/**
+ * malloc, calloc and realloc, which also add to the allocation counters.  The tools and
+ * libraries allocate through these so "allocations" and "allocated_bytes" cover the whole run.
+ * A realloc counts as a new allocation of its new size.
+ */
+void* perf_malloc(size_t size);
+void* perf_calloc(size_t count, size_t size);
+void* perf_realloc(void *ptr, size_t size);
+
+/**
+ * Ends a section of code started at "start" (use PERF_STOP rather than calling this).
+ */
+void perf_stop(int counter, const char *name, unsigned long long start);
+
+/**
+ * The current time in nanoseconds, for timing a section of code.
+ */
+unsigned long long perf_now(void);
+
+/*Timing a section: PERF_START(t) before it and PERF_STOP(PERF_COMPUTE_NS, "name", t) after.
+The time is added to the counter and the section shows up in the trace with that name.  The
+name must be a string constant.  Nothing is timed unless the counters or the trace are on.*/
+#define PERF_START(t) ((t) = (perf_enabled | perf_tracing) ? perf_now() : 0)
+#define PERF_STOP(counter, name, t) \
+	do { if(perf_enabled | perf_tracing) perf_stop((counter), (name), (t)); } while(0)
+
+#endif
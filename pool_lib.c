@@ -0,0 +1,404 @@
+/*Needed for sched_getaffinity*/
+#define _GNU_SOURCE
+#include "pool_lib.h"
+#include "perf_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*Starting size of each thread's queue.  They grow when needed.*/
+#define DEQUE_START 64
+/*Number of pieces pool_parallel_for makes for each thread when it picks the grain*/
+#define PIECES_PER_THREAD 4
+
+/**
+ * A queued piece of work.  A task that was spawned frees itself once it has run, the others
+ * are freed by pool_wait.
+ */
+typedef struct pool_task
+{
+	void (*func)(void *arg);
+	void *arg;
+	int detached;
+	atomic_int done;
+} PoolTask;
+
+/**
+ * The queue of one thread.  The owner adds and takes tasks at the bottom, so it works on the
+ * newest (and most likely still in the cache) first.  A thread with nothing to do steals from
+ * the top, taking the oldest.  Each queue has its own lock, which is only ever fought over
+ * when a thread is stealing.
+ */
+typedef struct pool_deque
+{
+	pthread_mutex_t lock;
+	PoolTaskPtr *tasks;
+	int capacity;
+	int top;
+	int bottom;
+} PoolDeque;
+
+/**
+ * A piece of a pool_parallel_for.
+ */
+typedef struct pool_range
+{
+	void (*func)(void *arg, int from, int to);
+	void *arg;
+	int from;
+	int to;
+} PoolRange;
+
+/*Queue 0 is shared by all the threads that aren't in the pool, the pool's workers have the
+rest.  Everything else is set once by start_pool.*/
+static PoolDeque deques[POOL_MAX_THREADS];
+static int num_threads = 0;
+static int requested_threads = 0;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static _Thread_local int my_deque = 0;
+
+/*Threads with nothing to do sleep on pool_wake.  "queued" is the number of tasks waiting in
+all the queues, and "sleepers" the number of threads asleep, so nobody has to take the lock
+unless someone is asleep.*/
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static atomic_int queued = 0;
+static atomic_int sleepers = 0;
+
+static void start_pool(void);
+static int allowed_cpus(void);
+static void *pool_worker(void *arg);
+static PoolTaskPtr queue_task(void (*func)(void *arg), void *arg, int detached);
+static PoolTaskPtr find_task(void);
+static void run_task(PoolTaskPtr task);
+static void sleep_until_work(PoolTaskPtr waiting_for);
+static void wake_sleepers(void);
+static void run_range(void *arg);
+
+/**
+ * Sets the number of threads for when the pool starts.  See pool_lib.h.
+ */
+void pool_init(int threads)
+{
+	requested_threads = threads;
+	pthread_once(&pool_once, start_pool);
+}
+
+/**
+ * The number of threads the pool uses.
+ */
+int pool_size(void)
+{
+	pthread_once(&pool_once, start_pool);
+	return num_threads;
+}
+
+/**
+ * Queues a task and returns its future.
+ */
+PoolTaskPtr pool_submit(void (*func)(void *arg), void *arg)
+{
+	return queue_task(func, arg, 0);
+}
+
+/**
+ * Queues a task that nothing will wait for.
+ */
+void pool_spawn(void (*func)(void *arg), void *arg)
+{
+	queue_task(func, arg, 1);
+}
+
+/**
+ * Runs queued tasks until "task" is done, sleeping when there aren't any, then frees it.
+ */
+void pool_wait(PoolTaskPtr task)
+{
+	PoolTaskPtr other;
+
+	while(!atomic_load(&task->done))
+	{
+		if((other = find_task()) != NULL)
+		{
+			run_task(other);
+		}
+		else
+		{
+			sleep_until_work(task);
+		}
+	}
+	free(task);
+}
+
+/**
+ * Splits the range into pieces, queues all but the first and runs the first on this thread.
+ * See pool_lib.h.
+ */
+void pool_parallel_for(int start, int end, int grain,
+						void (*func)(void *arg, int from, int to), void *arg)
+{
+	PoolRange *ranges;
+	PoolTaskPtr *tasks;
+	int num_pieces, i;
+
+	if(end <= start)
+	{
+		return;
+	}
+	if(grain <= 0)
+	{
+		grain = (end - start + PIECES_PER_THREAD*pool_size() - 1) /
+					(PIECES_PER_THREAD*pool_size());
+	}
+	num_pieces = (end - start + grain - 1) / grain;
+	if(num_pieces == 1 || pool_size() == 1)
+	{
+		func(arg, start, end);
+		return;
+	}
+
+	ranges = (PoolRange*)perf_malloc(num_pieces * sizeof(PoolRange));
+	tasks = (PoolTaskPtr*)perf_malloc(num_pieces * sizeof(PoolTaskPtr));
+	for(i=0; i<num_pieces; i++)
+	{
+		ranges[i].func = func;
+		ranges[i].arg = arg;
+		ranges[i].from = start + i*grain;
+		ranges[i].to = (end - ranges[i].from > grain) ? ranges[i].from + grain : end;
+	}
+	/*Queued backwards so the pieces this thread takes back off the bottom of its own queue
+	come in order*/
+	for(i=num_pieces-1; i>0; i--)
+	{
+		tasks[i] = pool_submit(run_range, &ranges[i]);
+	}
+	func(arg, ranges[0].from, ranges[0].to);
+	for(i=1; i<num_pieces; i++)
+	{
+		pool_wait(tasks[i]);
+	}
+	free(ranges);
+	free(tasks);
+}
+
+/**
+ * Works out the number of threads and starts the workers.  There's always at least one worker
+ * so spawned tasks get run even when there's only one CPU.
+ */
+static void start_pool(void)
+{
+	const char *env = getenv("SOUND_THREADS");
+	pthread_t thread;
+	int i;
+
+	num_threads = requested_threads;
+	if(num_threads <= 0 && env != NULL)
+	{
+		num_threads = atoi(env);
+	}
+	if(num_threads <= 0)
+	{
+		num_threads = allowed_cpus();
+	}
+	if(num_threads > POOL_MAX_THREADS)
+	{
+		num_threads = POOL_MAX_THREADS;
+	}
+
+	for(i=0; i<POOL_MAX_THREADS; i++)
+	{
+		pthread_mutex_init(&deques[i].lock, NULL);
+		deques[i].capacity = (i < num_threads || i == 1) ? DEQUE_START : 0;
+		deques[i].tasks = (PoolTaskPtr*)perf_malloc(deques[i].capacity * sizeof(PoolTaskPtr));
+		deques[i].top = 0;
+		deques[i].bottom = 0;
+	}
+	for(i=1; i<num_threads || i == 1; i++)
+	{
+		if(pthread_create(&thread, NULL, pool_worker, (void*)(long)i) == 0)
+		{
+			pthread_detach(thread);
+		}
+		else
+		{
+			fprintf(stderr, "Could not start a pool thread.\n");
+		}
+	}
+}
+
+/**
+ * The number of CPUs this process is allowed to run on.
+ */
+static int allowed_cpus(void)
+{
+	cpu_set_t cpus;
+	long online;
+
+	if(sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) > 0)
+	{
+		return CPU_COUNT(&cpus);
+	}
+	online = sysconf(_SC_NPROCESSORS_ONLN);
+	return (online > 0) ? online : 1;
+}
+
+/**
+ * Thread function for the pool's workers.  Runs tasks forever, sleeping when there are none.
+ * The workers are never stopped, they just go away when the program exits.
+ */
+static void *pool_worker(void *arg)
+{
+	PoolTaskPtr task;
+
+	my_deque = (int)(long)arg;
+	while(1)
+	{
+		if((task = find_task()) != NULL)
+		{
+			run_task(task);
+		}
+		else
+		{
+			sleep_until_work(NULL);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Makes a task and adds it to the bottom of the calling thread's queue, growing it if it's
+ * full.
+ */
+static PoolTaskPtr queue_task(void (*func)(void *arg), void *arg, int detached)
+{
+	PoolTaskPtr task = (PoolTaskPtr)perf_malloc(sizeof(PoolTask));
+	PoolDeque *deque;
+
+	pthread_once(&pool_once, start_pool);
+	deque = &deques[my_deque];
+	task->func = func;
+	task->arg = arg;
+	task->detached = detached;
+	atomic_init(&task->done, 0);
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->bottom == deque->capacity)
+	{
+		/*Move everything back to the front first, and only grow if that didn't make room*/
+		memmove(deque->tasks, deque->tasks + deque->top,
+					(deque->bottom - deque->top) * sizeof(PoolTaskPtr));
+		deque->bottom -= deque->top;
+		deque->top = 0;
+		if(deque->bottom == deque->capacity)
+		{
+			deque->capacity = 2 * deque->capacity;
+			deque->tasks = (PoolTaskPtr*)perf_realloc(deque->tasks,
+												deque->capacity * sizeof(PoolTaskPtr));
+		}
+	}
+	deque->tasks[deque->bottom++] = task;
+	pthread_mutex_unlock(&deque->lock);
+
+	atomic_fetch_add(&queued, 1);
+	wake_sleepers();
+	return task;
+}
+
+/**
+ * Takes the newest task from the calling thread's own queue, or steals the oldest one from
+ * another queue if its own is empty.  Returns NULL if there's nothing queued anywhere.
+ */
+static PoolTaskPtr find_task(void)
+{
+	PoolDeque *deque = &deques[my_deque];
+	PoolTaskPtr task = NULL;
+	int total = (num_threads > 2) ? num_threads : 2;
+	int i;
+
+	if(atomic_load(&queued) <= 0)
+	{
+		return NULL;
+	}
+	pthread_mutex_lock(&deque->lock);
+	if(deque->bottom > deque->top)
+	{
+		task = deque->tasks[--deque->bottom];
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	/*Start with the next queue along so the thieves spread out*/
+	for(i=1; i<total && task == NULL; i++)
+	{
+		deque = &deques[(my_deque + i) % total];
+		pthread_mutex_lock(&deque->lock);
+		if(deque->bottom > deque->top)
+		{
+			task = deque->tasks[deque->top++];
+		}
+		pthread_mutex_unlock(&deque->lock);
+	}
+	if(task != NULL)
+	{
+		atomic_fetch_sub(&queued, 1);
+	}
+	return task;
+}
+
+/**
+ * Runs a task and marks it done, waking anyone waiting for it.
+ */
+static void run_task(PoolTaskPtr task)
+{
+	task->func(task->arg);
+	if(task->detached)
+	{
+		free(task);
+		return;
+	}
+	atomic_store(&task->done, 1);
+	wake_sleepers();
+}
+
+/**
+ * Sleeps until there's a task queued, or until "waiting_for" is done if it isn't NULL.
+ * "sleepers" goes up before the check under the lock, and the other threads change "queued"
+ * or "done" before they check "sleepers", so a wake up can't be missed.
+ */
+static void sleep_until_work(PoolTaskPtr waiting_for)
+{
+	pthread_mutex_lock(&pool_lock);
+	atomic_fetch_add(&sleepers, 1);
+	while(atomic_load(&queued) <= 0 &&
+			(waiting_for == NULL || !atomic_load(&waiting_for->done)))
+	{
+		pthread_cond_wait(&pool_wake, &pool_lock);
+	}
+	atomic_fetch_sub(&sleepers, 1);
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * Wakes every sleeping thread so they can look for work again.
+ */
+static void wake_sleepers(void)
+{
+	if(atomic_load(&sleepers) > 0)
+	{
+		pthread_mutex_lock(&pool_lock);
+		pthread_cond_broadcast(&pool_wake);
+		pthread_mutex_unlock(&pool_lock);
+	}
+}
+
+/**
+ * Task function for one piece of a pool_parallel_for.
+ */
+static void run_range(void *arg)
+{
+	PoolRange *range = (PoolRange*)arg;
+	range->func(range->arg, range->from, range->to);
+}
@@ -0,0 +1,48 @@
+#ifndef POOL_LIB_H_
+#define POOL_LIB_H_
+
+/*Most threads the pool will use*/
+#define POOL_MAX_THREADS 64
+
+typedef struct pool_task *PoolTaskPtr;
+
+/**
+ * Sets how many threads the pool uses, counting the thread that waits for the work.  0 means
+ * one for each CPU the process is allowed to run on (its affinity), unless the SOUND_THREADS
+ * environment variable says otherwise.  This only has an effect if it's called before the pool
+ * is first used; otherwise the pool starts itself with 0.
+ */
+void pool_init(int num_threads);
+
+/**
+ * The number of threads the pool uses, starting it if it hasn't been.
+ */
+int pool_size(void);
+
+/**
+ * Queues func(arg) to be run by the pool and returns its future.  Every future must be passed
+ * to pool_wait exactly once.
+ */
+PoolTaskPtr pool_submit(void (*func)(void *arg), void *arg);
+
+/**
+ * Waits for a task to finish and frees it.  While it waits the calling thread runs other
+ * queued tasks, so tasks can submit and wait for their own tasks without deadlocking.
+ */
+void pool_wait(PoolTaskPtr task);
+
+/**
+ * Queues func(arg) for the pool without a future, for work that nothing waits for.
+ */
+void pool_spawn(void (*func)(void *arg), void *arg);
+
+/**
+ * Calls func(arg, from, to) for pieces of the range start to end (not including end) on the
+ * pool's threads, including the calling one, and returns once they're all done.  Each piece
+ * has "grain" values, except maybe the last.  A grain of 0 or less picks one that gives each
+ * thread a few pieces, so the ones that finish early can take work from the others.
+ */
+void pool_parallel_for(int start, int end, int grain,
+						void (*func)(void *arg, int from, int to), void *arg);
+
+#endif
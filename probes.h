@@ -0,0 +1,33 @@
+#ifndef PROBES_H_
+#define PROBES_H_
+
+/*Static probe points (USDT) for tracing a running program with bpftrace, perf or SystemTap
+without rebuilding it, e.g.
+
+	bpftrace -e 'usdt:./dtmf:sound:dtmf_digit { printf("%c\n", arg0); }' -c "./dtmf < in.raw"
+
+All the probes are in the "sound" provider.  When <sys/sdt.h> is there (the Makefile checks
+for it and defines HAVE_SYS_SDT_H) each probe is a single nop in the code with its location
+and arguments written to a note section, so it costs next to nothing until something attaches
+to it.  Otherwise the macros compile to nothing (the arguments are only cast to void so they
+don't show up as unused).  Arguments should be integers or pointers.
+
+	read_block(requested, read, bit_size)		util.c read_samples
+	write_block(count, bit_size)				util.c output_samples
+	dtmf_window(frequency mask, window size)	dtmf_lib.c get_fourier, bit 8 is "nothing present"
+	dtmf_digit(button character)				dtmf_lib.c print_button
+	mix_block(first sample, samples)			mix_lib.c mix_files, as each block is summed
+	reverb_block(samples)						reverb_lib.c, convreverb.c and fdnreverb.c, per block
+*/
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define SOUND_PROBE1(name, a) DTRACE_PROBE1(sound, name, a)
+#define SOUND_PROBE2(name, a, b) DTRACE_PROBE2(sound, name, a, b)
+#define SOUND_PROBE3(name, a, b, c) DTRACE_PROBE3(sound, name, a, b, c)
+#else
+#define SOUND_PROBE1(name, a) do { (void)(a); } while(0)
+#define SOUND_PROBE2(name, a, b) do { (void)(a); (void)(b); } while(0)
+#define SOUND_PROBE3(name, a, b, c) do { (void)(a); (void)(b); (void)(c); } while(0)
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "input_lib.h"
+#include "resample_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+
+/**
+ * Resample
+ * This program reads a sound sample file from standard input and converts it to a new sample
+ * rate using a polyphase filter.  The converted sound is written to standard output.
+ *
+ * Command Line Variables: resample <new sample rate>
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	FileInfoPtr file_info;
+	ResamplerPtr rs;
+	int new_rate, channels, err_no;
+	int num_read, out_frames, out_max;
+	unsigned new_num_samples = 0;
+	unsigned *samples;
+	float *in_float, *out_float;
+	unsigned long long perf_start;
+
+	perf_init(&argc, argv);
+	
+	if(argc != 2)
+	{
+		fprintf(stderr, "You must specify the new sample rate.\n");
+		return 1;
+	}
+	new_rate = atoi(argv[1]);
+	if(new_rate <= 0 || new_rate >= INT_MAX)
+	{
+		fprintf(stderr, "The value for sample rate is not a legal positive integer.\n");
+		return 1;
+	}
+
+	file_info = (FileInfoPtr)perf_malloc(sizeof(FileInfo));
+	if((err_no = parse_header(stdin, file_info, NONE)) != 0)
+	{
+		free(file_info);
+		return err_no;
+	}
+	channels = (file_info->mono_or_stereo == STEREO) ? 2 : 1;
+
+	if((rs = resampler_create(file_info->frequency, new_rate, channels)) == NULL)
+	{
+		free(file_info);
+		return 1;
+	}
+
+	/*The number of samples is only known up front if it was in the header*/
+	if(file_info->num_samples != 0)
+	{
+		new_num_samples = resampled_length(file_info->num_samples, file_info->frequency,
+											new_rate);
+	}
+	print_header(new_rate, new_num_samples, file_info->mono_or_stereo, file_info->bit_size);
+
+	/*The output buffer has to be big enough for either a full block or the flush*/
+	out_max = resampled_length(RESAMPLE_BLOCK, file_info->frequency, new_rate) +
+					rs->bank->taps + 1;
+	samples = (unsigned*)perf_malloc((out_max > RESAMPLE_BLOCK ? out_max : RESAMPLE_BLOCK) * 
+								channels * sizeof(unsigned));
+	in_float = (float*)perf_malloc(RESAMPLE_BLOCK * channels * sizeof(float));
+	out_float = (float*)perf_malloc(out_max * channels * sizeof(float));
+
+	do
+	{
+		num_read = read_samples(stdin, file_info->bit_size, samples,
+							RESAMPLE_BLOCK * channels) / channels;
+		if(num_read > 0)
+		{
+			samples_to_float(samples, in_float, num_read * channels);
+			PERF_START(perf_start);
+			out_frames = resampler_process(rs, in_float, num_read, out_float);
+			PERF_STOP(PERF_COMPUTE_NS, "resample", perf_start);
+			perf_add(PERF_SAMPLES_PROCESSED, num_read);
+		}
+		else
+		{
+			out_frames = resampler_flush(rs, out_float);
+		}
+		float_to_samples(out_float, samples, out_frames * channels, file_info->bit_size);
+		output_samples(stdout, samples, out_frames * channels, file_info->bit_size);
+	} while(num_read > 0);
+
+	free(samples);
+	free(in_float);
+	free(out_float);
+	resampler_destroy(rs);
+	free(file_info);
+	return 0;
+}
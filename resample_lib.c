@@ -0,0 +1,393 @@
+#include "resample_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+/*The most phases we are willing to build a filter bank for.  Any two of the usual sample rates
+(8000, 11025, 16000, 22050, 32000, 44100, 48000, 96000) are well under this.*/
+#define MAX_PHASES 4096
+/*Half the filter length in input samples when no anti-aliasing is needed*/
+#define HALF_TAPS 16
+/*Cutoff as a fraction of the lower Nyquist frequency, leaves room for the transition band*/
+#define CUTOFF 0.95
+/*Kaiser window shape parameter, about 80dB of stop band attenuation*/
+#define KAISER_BETA 8.0
+
+/*Filter banks that have already been calculated.  The lock lets several threads resample at
+once.*/
+static FilterBankPtr bank_list = NULL;
+static pthread_mutex_t bank_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int gcd(int a, int b);
+static double bessel_i0(double x);
+static FilterBankPtr get_bank(int up, int down);
+static int produce_output(ResamplerPtr rs, float *out, long long limit);
+
+/**
+ * Creates a resampler converting from in_rate to out_rate.  Returns NULL and prints to stderr
+ * if the ratio between the rates can't be handled.
+ */
+ResamplerPtr resampler_create(int in_rate, int out_rate, int channels)
+{
+	ResamplerPtr rs;
+	int divisor, half, c;
+
+	if(in_rate <= 0 || out_rate <= 0)
+	{
+		fprintf(stderr, "Sample rates must be positive to resample.\n");
+		return NULL;
+	}
+	divisor = gcd(in_rate, out_rate);
+	if(out_rate / divisor > MAX_PHASES)
+	{
+		fprintf(stderr, "Can't resample from %d to %d, the ratio is too complex.\n",
+						in_rate, out_rate);
+		return NULL;
+	}
+
+	rs = (ResamplerPtr)perf_malloc(sizeof(Resampler));
+	rs->in_rate = in_rate;
+	rs->out_rate = out_rate;
+	rs->channels = channels;
+	rs->bank = get_bank(out_rate / divisor, in_rate / divisor);
+
+	half = rs->bank->taps / 2;
+	rs->hist_size = rs->bank->taps + RESAMPLE_BLOCK;
+	rs->history = (float**)perf_malloc(channels * sizeof(float*));
+	for(c=0; c<channels; c++)
+	{
+		rs->history[c] = (float*)perf_calloc(rs->hist_size, sizeof(float));
+	}
+
+	/*Start with half a filter of silence so the first output lines up with the first input*/
+	rs->hist_len = half - 1;
+	rs->hist_start = -(half - 1);
+	rs->next_in = 0;
+	rs->phase = 0;
+	rs->total_in = 0;
+	rs->total_out = 0;
+	return rs;
+}
+
+/**
+ * Frees the resampler.  The filter bank is kept around for reuse.
+ */
+void resampler_destroy(ResamplerPtr rs)
+{
+	int c;
+	for(c=0; c<rs->channels; c++)
+	{
+		free(rs->history[c]);
+	}
+	free(rs->history);
+	free(rs);
+}
+
+/**
+ * Converts "in_frames" frames of interleaved input.  The output is interleaved and written to
+ * "out", which must have room for resampled_length(in_frames, ...) + 1 frames.  Returns the
+ * number of frames written.
+ */
+int resampler_process(ResamplerPtr rs, const float *in, int in_frames, float *out)
+{
+	int done = 0;
+	int produced = 0;
+	int chunk, i, c;
+
+	while(done < in_frames)
+	{
+		/*Copy as much input as fits into the history buffers*/
+		chunk = rs->hist_size - rs->hist_len;
+		if(chunk > in_frames - done)
+		{
+			chunk = in_frames - done;
+		}
+		for(c=0; c<rs->channels; c++)
+		{
+			float *dest = rs->history[c] + rs->hist_len;
+			for(i=0; i<chunk; i++)
+			{
+				dest[i] = in[(done + i)*rs->channels + c];
+			}
+		}
+		rs->hist_len += chunk;
+		rs->total_in += chunk;
+		done += chunk;
+
+		produced += produce_output(rs, out + produced*rs->channels, -1);
+	}
+	return produced;
+}
+
+/**
+ * Called once the input is done.  Outputs the frames that were waiting on look-ahead.  Returns
+ * the number of frames written, which is never more than the filter length.
+ */
+int resampler_flush(ResamplerPtr rs, float *out)
+{
+	int half = rs->bank->taps / 2;
+	int c;
+	long long expected;
+
+	/*Pad with half a filter of silence so the last inputs can be centered on*/
+	for(c=0; c<rs->channels; c++)
+	{
+		memset(rs->history[c] + rs->hist_len, 0, half * sizeof(float));
+	}
+	rs->hist_len += half;
+
+	expected = resampled_length(rs->total_in, rs->in_rate, rs->out_rate);
+	return produce_output(rs, out, expected);
+}
+
+/**
+ * Returns the number of frames that "num_frames" input frames will become after conversion.
+ */
+unsigned resampled_length(unsigned num_frames, int in_rate, int out_rate)
+{
+	return (unsigned)(((long long)num_frames * out_rate + in_rate - 1) / in_rate);
+}
+
+/**
+ * Resamples the data of a file to the new rate.  The file pointer must point to the first byte
+ * of data.  Returns a malloc'ed array of interleaved samples and puts the number of frames in
+ * num_frames.  Returns NULL if the conversion can't be done.
+ */
+unsigned* resample_file(FILE *inp, FileInfoPtr file_info, int new_rate, unsigned *num_frames)
+{
+	ResamplerPtr rs;
+	int channels = (file_info->mono_or_stereo == STEREO) ? 2 : 1;
+	unsigned *in_samples;
+	float *in_float, *out_float;
+	unsigned *result;
+	unsigned capacity, used;
+	int num_read, out_frames, out_max;
+
+	if((rs = resampler_create(file_info->frequency, new_rate, channels)) == NULL)
+	{
+		return NULL;
+	}
+
+	out_max = resampled_length(RESAMPLE_BLOCK, file_info->frequency, new_rate) +
+					rs->bank->taps + 1;
+	in_samples = (unsigned*)perf_malloc(RESAMPLE_BLOCK * channels * sizeof(unsigned));
+	in_float = (float*)perf_malloc(RESAMPLE_BLOCK * channels * sizeof(float));
+	out_float = (float*)perf_malloc(out_max * channels * sizeof(float));
+
+	capacity = resampled_length(file_info->num_samples, file_info->frequency, new_rate) + 1;
+	result = (unsigned*)perf_malloc(capacity * channels * sizeof(unsigned));
+	used = 0;
+
+	do
+	{
+		num_read = read_samples(inp, file_info->bit_size, in_samples,
+							RESAMPLE_BLOCK * channels) / channels;
+		if(num_read > 0)
+		{
+			samples_to_float(in_samples, in_float, num_read * channels);
+			out_frames = resampler_process(rs, in_float, num_read, out_float);
+		}
+		else
+		{
+			out_frames = resampler_flush(rs, out_float);
+		}
+
+		if(used + out_frames > capacity)
+		{
+			capacity = 2*(used + out_frames);
+			result = (unsigned*)perf_realloc(result, capacity * channels * sizeof(unsigned));
+		}
+		float_to_samples(out_float, result + used*channels, out_frames * channels,
+							file_info->bit_size);
+		used += out_frames;
+	} while(num_read > 0);
+
+	free(in_samples);
+	free(in_float);
+	free(out_float);
+	resampler_destroy(rs);
+
+	*num_frames = used;
+	return result;
+}
+
+/**
+ * Makes as many output frames as the buffered input allows.  If limit is not negative, output
+ * stops once the total number of output frames reaches it.  Afterwards the history that is no
+ * longer needed is dropped.  Returns the number of frames written to out.
+ */
+static int produce_output(ResamplerPtr rs, float *out, long long limit)
+{
+	FilterBankPtr bank = rs->bank;
+	int taps = bank->taps;
+	int half = taps / 2;
+	long long last_frame = rs->hist_start + rs->hist_len - 1;
+	int produced = 0;
+	int c, j, l, drop;
+	const float *coeffs;
+	const float *x;
+	float acc[8];
+
+	while(rs->next_in + half <= last_frame && (limit < 0 || rs->total_out < limit))
+	{
+		coeffs = bank->coeffs + rs->phase * taps;
+		for(c=0; c<rs->channels; c++)
+		{
+			x = rs->history[c] + (rs->next_in - half + 1 - rs->hist_start);
+
+			/*Eight separate sums so the compiler can keep them in one vector register*/
+			for(l=0; l<8; l++)
+			{
+				acc[l] = 0.0f;
+			}
+			for(j=0; j<taps; j+=8)
+			{
+				for(l=0; l<8; l++)
+				{
+					acc[l] += coeffs[j+l] * x[j+l];
+				}
+			}
+			out[produced*rs->channels + c] = ((acc[0] + acc[1]) + (acc[2] + acc[3])) +
+										((acc[4] + acc[5]) + (acc[6] + acc[7]));
+		}
+		produced++;
+		rs->total_out++;
+
+		/*Step forward by down/up input samples*/
+		rs->phase += bank->down;
+		rs->next_in += rs->phase / bank->up;
+		rs->phase = rs->phase % bank->up;
+	}
+
+	/*Throw away the input that no future output will use*/
+	drop = (int)(rs->next_in - half + 1 - rs->hist_start);
+	if(drop > rs->hist_len)
+	{
+		drop = rs->hist_len;
+	}
+	if(drop > 0)
+	{
+		for(c=0; c<rs->channels; c++)
+		{
+			memmove(rs->history[c], rs->history[c] + drop,
+						(rs->hist_len - drop) * sizeof(float));
+		}
+		rs->hist_len -= drop;
+		rs->hist_start += drop;
+	}
+	return produced;
+}
+
+/**
+ * Finds the filter bank for the given ratio, calculating it if this is the first time the ratio
+ * has been used.  Each phase is a Kaiser windowed sinc, normalized so a constant input gives
+ * the same constant output.  This keeps the offset of unsigned samples where it was.  The
+ * lock is held while a new bank is calculated, so two threads never make the same one.
+ */
+static FilterBankPtr get_bank(int up, int down)
+{
+	FilterBankPtr bank;
+	double cutoff, d, w, sum, ratio;
+	int half, p, j;
+
+	pthread_mutex_lock(&bank_lock);
+	for(bank = bank_list; bank != NULL; bank = bank->next)
+	{
+		if(bank->up == up && bank->down == down)
+		{
+			pthread_mutex_unlock(&bank_lock);
+			return bank;
+		}
+	}
+
+	/*When going down in rate the cutoff has to drop to the new Nyquist frequency, and the
+	filter has to get longer to keep the same transition band*/
+	cutoff = CUTOFF;
+	if(up < down)
+	{
+		cutoff = CUTOFF * up / down;
+	}
+	half = (int)ceil(HALF_TAPS / cutoff);
+	half = (half + 3) & ~3;		/*taps = 2*half is then a multiple of 8*/
+
+	bank = (FilterBankPtr)perf_malloc(sizeof(FilterBank));
+	bank->up = up;
+	bank->down = down;
+	bank->taps = 2*half;
+	bank->coeffs = (float*)perf_malloc(up * bank->taps * sizeof(float));
+
+	for(p=0; p<up; p++)
+	{
+		double *phase = (double*)perf_malloc(bank->taps * sizeof(double));
+		sum = 0.0;
+		for(j=0; j<bank->taps; j++)
+		{
+			/*Distance from the output time to the input sample this tap multiplies*/
+			d = (double)p/up + half - 1 - j;
+			ratio = d / half;
+			if(ratio <= -1.0 || ratio >= 1.0)
+			{
+				phase[j] = 0.0;
+				continue;
+			}
+			w = bessel_i0(KAISER_BETA * sqrt(1.0 - ratio*ratio)) / bessel_i0(KAISER_BETA);
+			if(d == 0.0)
+			{
+				phase[j] = cutoff * w;
+			}
+			else
+			{
+				phase[j] = w * sin(M_PI * cutoff * d) / (M_PI * d);
+			}
+			sum += phase[j];
+		}
+		for(j=0; j<bank->taps; j++)
+		{
+			bank->coeffs[p*bank->taps + j] = (float)(phase[j] / sum);
+		}
+		free(phase);
+	}
+
+	bank->next = bank_list;
+	bank_list = bank;
+	pthread_mutex_unlock(&bank_lock);
+	return bank;
+}
+
+/**
+ * Modified Bessel function of the first kind, order 0.  Used for the Kaiser window.
+ */
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	int k;
+	for(k=1; k<50; k++)
+	{
+		term = term * (x / (2.0*k)) * (x / (2.0*k));
+		sum += term;
+		if(term < sum * 1e-12)
+		{
+			break;
+		}
+	}
+	return sum;
+}
+
+/**
+ * Greatest common divisor, used to reduce the ratio between the two rates.
+ */
+static int gcd(int a, int b)
+{
+	int t;
+	while(b != 0)
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
@@ -0,0 +1,86 @@
+#ifndef RESAMPLE_LIB_H_
+#define RESAMPLE_LIB_H_
+
+#include <stdio.h>
+#include "input_lib.h"
+
+/*Number of input frames the resampler buffers at a time*/
+#define RESAMPLE_BLOCK 4096
+
+typedef struct filter_bank *FilterBankPtr;
+
+/**
+ * A polyphase filter bank for converting by the ratio up/down.  There is one set of "taps"
+ * coefficients for each of the "up" phases.  Banks are shared between resamplers that use
+ * the same ratio, so they are only calculated once.
+ */
+typedef struct filter_bank
+{
+	int up;
+	int down;
+	int taps;		/*Coefficients per phase, always a multiple of 8*/
+	float *coeffs;	/*up * taps coefficients, phase by phase*/
+	FilterBankPtr next;
+} FilterBank;
+
+typedef struct resampler *ResamplerPtr;
+
+/**
+ * Holds the state of one sample rate conversion.  The input is kept deinterleaved, one
+ * buffer per channel, so the inner loop is a straight dot product.
+ */
+typedef struct resampler
+{
+	int in_rate;
+	int out_rate;
+	int channels;
+	FilterBankPtr bank;
+
+	float **history;	/*One buffer per channel*/
+	int hist_len;		/*Number of valid frames in each history buffer*/
+	int hist_size;		/*Capacity of each history buffer in frames*/
+	long long hist_start;	/*Input frame number of history[c][0]*/
+
+	long long next_in;	/*Input frame the next output is centered on*/
+	int phase;			/*Phase of the next output*/
+	long long total_in;	/*Input frames seen so far*/
+	long long total_out;	/*Output frames produced so far*/
+} Resampler;
+
+/**
+ * Creates a resampler converting from in_rate to out_rate.  Returns NULL and prints to stderr
+ * if the ratio between the rates can't be handled.
+ */
+ResamplerPtr resampler_create(int in_rate, int out_rate, int channels);
+
+/**
+ * Frees the resampler.  The filter bank is kept around for reuse.
+ */
+void resampler_destroy(ResamplerPtr rs);
+
+/**
+ * Converts "in_frames" frames of interleaved input.  The output is interleaved and written to
+ * "out", which must have room for resampled_length(in_frames, ...) + 1 frames.  Returns the
+ * number of frames written.
+ */
+int resampler_process(ResamplerPtr rs, const float *in, int in_frames, float *out);
+
+/**
+ * Called once the input is done.  Outputs the frames that were waiting on look-ahead.  Returns
+ * the number of frames written, which is never more than the filter length.
+ */
+int resampler_flush(ResamplerPtr rs, float *out);
+
+/**
+ * Returns the number of frames that "num_frames" input frames will become after conversion.
+ */
+unsigned resampled_length(unsigned num_frames, int in_rate, int out_rate);
+
+/**
+ * Resamples the data of a file to the new rate.  The file pointer must point to the first byte
+ * of data.  Returns a malloc'ed array of interleaved samples and puts the number of frames in
+ * num_frames.  Returns NULL if the conversion can't be done.
+ */
+unsigned* resample_file(FILE *inp, FileInfoPtr file_info, int new_rate, unsigned *num_frames);
+
+#endif
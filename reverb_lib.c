@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "reverb_lib.h"
+#include "input_lib.h"
+#include "delay_lib.h"
+#include "ring_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include "probes.h"
+
+#define MILLSEC_TO_SEC .001
+/*Number of blocks the reader thread can get ahead by*/
+#define RING_SLOTS 8
+
+static void reverb_block(FILE *out, DelayLinePtr delay_line, unsigned *samples, int count,
+							int channels, int bit_size);
+
+/**
+ * Adds the echoes to a sound file.  See reverb_lib.h.
+ */
+int reverb_file(FILE *inp, FILE *out, const int *delays, const int *percents, int num_echoes,
+					int pipelined)
+{
+	int channels, i;
+	int err_no;
+	int samples_read;
+	unsigned num_samples = 0;
+	unsigned *samples;
+	unsigned *block;
+	FileInfo file_info;
+	DelayTap *taps;
+	DelayLinePtr delay_line;
+	SampleRingPtr ring = NULL;
+	pthread_t reader;
+
+	/*Parse the header and keep the info*/
+	if((err_no = parse_header_to(inp, out, &file_info, REVERB)) != 0)
+	{
+		return err_no;
+	}
+	channels = (file_info.mono_or_stereo == STEREO) ? 2 : 1;
+
+	/*Figure out how many samples are delayed (convert from ms to num samples).  The delay
+	line works in frames, so stereo files don't need their delays doubled.*/
+	taps = (DelayTap*)perf_malloc(num_echoes * sizeof(DelayTap));
+	for(i=0; i<num_echoes; i++)
+	{
+		taps[i].delay = MILLSEC_TO_SEC*(file_info.frequency)*delays[i];
+		if(percents[i] < 0)
+		{
+			fprintf(stderr, "Each percent parameter input must be between 0 and 100.\n");
+			free(taps);
+			return 1;
+		}
+		taps[i].percent = percents[i];
+	}
+
+	if((delay_line = delay_create(taps, num_echoes, channels)) == NULL)
+	{
+		free(taps);
+		return 1;
+	}
+	free(taps);
+
+	/*Start the reader thread if there is one.  If it can't be started everything is just done
+	on this thread.*/
+	if(pipelined)
+	{
+		ring = ring_create(RING_SLOTS, DELAY_BLOCK * channels);
+		if(ring != NULL && ring_start_reader(ring, inp, file_info.bit_size, &reader) != 0)
+		{
+			ring_destroy(ring);
+			ring = NULL;
+		}
+	}
+	
+	/*Read a block at a time, add the echoes and write it back out.*/
+	samples = (unsigned*)perf_malloc(DELAY_BLOCK * channels * sizeof(unsigned));
+	if(ring != NULL)
+	{
+		while((block = ring_begin_read(ring, &samples_read)) != NULL)
+		{
+			reverb_block(out, delay_line, block, samples_read, channels, file_info.bit_size);
+			num_samples += samples_read;
+			ring_end_read(ring);
+		}
+		pthread_join(reader, NULL);
+		ring_destroy(ring);
+	}
+	else
+	{
+		while((samples_read = read_samples(inp, file_info.bit_size, samples,
+												DELAY_BLOCK * channels)) > 0)
+		{
+			reverb_block(out, delay_line, samples, samples_read, channels, file_info.bit_size);
+			num_samples += samples_read;
+		}
+	}
+	free(samples);
+	delay_destroy(delay_line);
+
+	/*Check that numb of samples in file was even if stereo, and also equal to the amount
+	specified in the header.*/
+	if(file_info.mono_or_stereo == STEREO)
+	{
+		if(num_samples % 2 != 0)
+		{
+			fprintf(stderr, "Stereo files must have an even number of samples");
+			return 1;
+		}
+		/*Each sample consists of a pair when the channel type is stereo*/
+		num_samples = num_samples / 2;
+	}
+	if(file_info.num_samples != 0 && num_samples != file_info.num_samples)
+	{
+		fprintf(stderr, "The number of samples in the file does not match the value in the header.");
+		fprintf(stderr, "Header: %d\nFile: %d",
+					file_info.num_samples, num_samples);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Adds the echoes to one block of samples (both channels interleaved if there are two) and
+ * writes it out.
+ */
+static void reverb_block(FILE *out, DelayLinePtr delay_line, unsigned *samples, int count,
+							int channels, int bit_size)
+{
+	unsigned long long perf_start;
+
+	PERF_START(perf_start);
+	delay_process(delay_line, samples, count / channels);
+	PERF_STOP(PERF_COMPUTE_NS, "delay_process", perf_start);
+	SOUND_PROBE1(reverb_block, count);
+	perf_add(PERF_SAMPLES_PROCESSED, count);
+	output_samples(out, samples, count, bit_size);
+}
@@ -0,0 +1,15 @@
+#ifndef REVERB_LIB_H_
+#define REVERB_LIB_H_
+
+#include <stdio.h>
+
+/**
+ * Reads a sound file from "inp", adds the echoes and writes the result to "out".  Echo i is
+ * delays[i] milliseconds late and percents[i] percent (0 to 100) as loud.  If "pipelined" is
+ * set the samples are read on their own thread and passed over in blocks through a ring.
+ * Returns 0 on success and 1 on failure (error written to stderr).
+ */
+int reverb_file(FILE *inp, FILE *out, const int *delays, const int *percents, int num_echoes,
+					int pipelined);
+
+#endif
@@ -0,0 +1,265 @@
+#include "ring_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+/*How many times a thread yields before it goes to sleep waiting for the other one*/
+#define RING_SPINS 64
+/*Keeps the two indexes on separate cache lines so the threads don't fight over them*/
+#define CACHE_LINE 64
+
+/**
+ * The ring.  "head" is the number of blocks written and is only changed by the producer,
+ * "tail" is the number used and is only changed by the consumer.  Both just keep counting up
+ * and wrap around together, and the number of slots is a power of two so a count can be
+ * turned into a slot with a mask.  The lock and condition are only used by a thread that has
+ * to sleep and by the other thread to wake it up.
+ */
+typedef struct sample_ring
+{
+	_Alignas(CACHE_LINE) atomic_uint head;
+	_Alignas(CACHE_LINE) atomic_uint tail;
+	_Alignas(CACHE_LINE) atomic_int closed;
+	atomic_int producer_waiting;
+	atomic_int consumer_waiting;
+	unsigned mask;
+	int slot_size;
+	unsigned *data;
+	int *counts;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} SampleRing;
+
+/**
+ * What the reader thread needs to know.
+ */
+typedef struct ring_reader
+{
+	SampleRingPtr ring;
+	FILE *inp;
+	int bit_size;
+} RingReader;
+
+static int can_write(SampleRingPtr ring);
+static int can_read(SampleRingPtr ring);
+static void wait_until(SampleRingPtr ring, int (*ready)(SampleRingPtr), atomic_int *waiting);
+static void wake(SampleRingPtr ring, atomic_int *waiting);
+static void *reader_thread(void *arg);
+
+/**
+ * Makes a ring of blocks for one producer and one consumer.  The number of slots is rounded up
+ * to a power of two.  See ring_lib.h.
+ */
+SampleRingPtr ring_create(int num_slots, int slot_size)
+{
+	SampleRingPtr ring;
+	unsigned slots = 1;
+
+	while(slots < (unsigned)num_slots)
+	{
+		slots = slots << 1;
+	}
+	/*The size of the struct is already a multiple of the cache line because of the _Alignas*/
+	if((ring = (SampleRingPtr)aligned_alloc(CACHE_LINE, sizeof(SampleRing))) == NULL)
+	{
+		return NULL;
+	}
+	ring->data = (unsigned*)perf_malloc((size_t)slots * slot_size * sizeof(unsigned));
+	ring->counts = (int*)perf_malloc(slots * sizeof(int));
+	if(ring->data == NULL || ring->counts == NULL)
+	{
+		free(ring->data);
+		free(ring->counts);
+		free(ring);
+		return NULL;
+	}
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->closed, 0);
+	atomic_init(&ring->producer_waiting, 0);
+	atomic_init(&ring->consumer_waiting, 0);
+	ring->mask = slots - 1;
+	ring->slot_size = slot_size;
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->changed, NULL);
+	return ring;
+}
+
+/**
+ * Frees the ring.
+ */
+void ring_destroy(SampleRingPtr ring)
+{
+	pthread_mutex_destroy(&ring->lock);
+	pthread_cond_destroy(&ring->changed);
+	free(ring->data);
+	free(ring->counts);
+	free(ring);
+}
+
+/**
+ * Producer: returns the next free block, waiting if the ring is full.
+ */
+unsigned *ring_begin_write(SampleRingPtr ring)
+{
+	unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	if(!can_write(ring))
+	{
+		wait_until(ring, can_write, &ring->producer_waiting);
+	}
+	return ring->data + (size_t)(head & ring->mask) * ring->slot_size;
+}
+
+/**
+ * Producer: publishes the block.  Storing the new head is what makes the samples visible to
+ * the consumer.
+ */
+void ring_end_write(SampleRingPtr ring, int count)
+{
+	unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	ring->counts[head & ring->mask] = count;
+	atomic_store(&ring->head, head + 1);
+	wake(ring, &ring->consumer_waiting);
+}
+
+/**
+ * Producer: no more blocks are coming.
+ */
+void ring_close(SampleRingPtr ring)
+{
+	atomic_store(&ring->closed, 1);
+	wake(ring, &ring->consumer_waiting);
+}
+
+/**
+ * Consumer: returns the next block, waiting if the ring is empty, or NULL at the end.
+ */
+unsigned *ring_begin_read(SampleRingPtr ring, int *count)
+{
+	unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if(!can_read(ring))
+	{
+		wait_until(ring, can_read, &ring->consumer_waiting);
+	}
+	/*Closed is only set after the last block is written, so check for a block first*/
+	if(atomic_load(&ring->head) == tail)
+	{
+		return NULL;
+	}
+	*count = ring->counts[tail & ring->mask];
+	return ring->data + (size_t)(tail & ring->mask) * ring->slot_size;
+}
+
+/**
+ * Consumer: gives the block back so the producer can fill it again.
+ */
+void ring_end_read(SampleRingPtr ring)
+{
+	atomic_store(&ring->tail, atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1);
+	wake(ring, &ring->producer_waiting);
+}
+
+/**
+ * Starts the thread that fills the ring from a file.  See ring_lib.h.
+ */
+int ring_start_reader(SampleRingPtr ring, FILE *inp, int bit_size, pthread_t *thread)
+{
+	RingReader *reader = (RingReader*)perf_malloc(sizeof(RingReader));
+
+	reader->ring = ring;
+	reader->inp = inp;
+	reader->bit_size = bit_size;
+	if(pthread_create(thread, NULL, reader_thread, reader) != 0)
+	{
+		free(reader);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Whether the producer has a free block.
+ */
+static int can_write(SampleRingPtr ring)
+{
+	return atomic_load(&ring->head) - atomic_load(&ring->tail) <= ring->mask;
+}
+
+/*
+ * Whether the consumer has a block, or the ring has been closed.
+ */
+static int can_read(SampleRingPtr ring)
+{
+	return atomic_load(&ring->head) != atomic_load(&ring->tail) || atomic_load(&ring->closed);
+}
+
+/**
+ * Waits until "ready" is true.  The other thread usually catches up quickly, so this yields a
+ * few times before going to sleep.  "waiting" is set before "ready" is checked again under the
+ * lock, and the other thread changes the ring before it checks "waiting", so one of them
+ * always sees the other and the wake up can't be missed.
+ */
+static void wait_until(SampleRingPtr ring, int (*ready)(SampleRingPtr), atomic_int *waiting)
+{
+	int i;
+
+	for(i=0; i<RING_SPINS; i++)
+	{
+		sched_yield();
+		if(ready(ring))
+		{
+			return;
+		}
+	}
+	pthread_mutex_lock(&ring->lock);
+	atomic_store(waiting, 1);
+	while(!ready(ring))
+	{
+		pthread_cond_wait(&ring->changed, &ring->lock);
+	}
+	atomic_store(waiting, 0);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Wakes the other thread if it's asleep in wait_until.
+ */
+static void wake(SampleRingPtr ring, atomic_int *waiting)
+{
+	if(atomic_load(waiting))
+	{
+		pthread_mutex_lock(&ring->lock);
+		pthread_cond_broadcast(&ring->changed);
+		pthread_mutex_unlock(&ring->lock);
+	}
+}
+
+/**
+ * Thread function for ring_start_reader.  A short block means the file has ended.
+ */
+static void *reader_thread(void *arg)
+{
+	RingReader *reader = (RingReader*)arg;
+	SampleRingPtr ring = reader->ring;
+	unsigned *block;
+	int count;
+
+	do
+	{
+		block = ring_begin_write(ring);
+		count = read_samples(reader->inp, reader->bit_size, block, ring->slot_size);
+		if(count > 0)
+		{
+			ring_end_write(ring, count);
+		}
+	} while(count == ring->slot_size);
+
+	ring_close(ring);
+	free(reader);
+	return NULL;
+}
@@ -0,0 +1,57 @@
+#ifndef RING_LIB_H_
+#define RING_LIB_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+typedef struct sample_ring *SampleRingPtr;
+
+/**
+ * Makes a ring of "num_slots" blocks of "slot_size" samples each, for passing blocks from one
+ * thread (the producer) to one other thread (the consumer).  The blocks are filled and used in
+ * place, so nothing is copied.  Passing a block doesn't take a lock; a thread only sleeps when
+ * the ring is full (producer) or empty (consumer).  Returns NULL if there isn't enough memory.
+ */
+SampleRingPtr ring_create(int num_slots, int slot_size);
+
+/**
+ * Frees the ring.  Neither thread can be using it anymore.
+ */
+void ring_destroy(SampleRingPtr ring);
+
+/**
+ * Producer: returns the next free block to fill, waiting for the consumer if they're all in
+ * use.
+ */
+unsigned *ring_begin_write(SampleRingPtr ring);
+
+/**
+ * Producer: hands the block from ring_begin_write to the consumer with "count" samples in it.
+ */
+void ring_end_write(SampleRingPtr ring, int count);
+
+/**
+ * Producer: there won't be any more blocks.  The consumer gets the ones already written first.
+ */
+void ring_close(SampleRingPtr ring);
+
+/**
+ * Consumer: returns the next block and puts the number of samples in it in "count", waiting
+ * for the producer if there isn't one yet.  Returns NULL once the ring has been closed and
+ * every block has been used.
+ */
+unsigned *ring_begin_read(SampleRingPtr ring, int *count);
+
+/**
+ * Consumer: gives the block from ring_begin_read back to the producer.
+ */
+void ring_end_read(SampleRingPtr ring);
+
+/**
+ * Starts a thread that reads samples from "inp" with read_samples, a block at a time, into the
+ * ring and closes it at the end of the file.  Only the last block can be short.  Returns 0 on
+ * success and 1 if the thread can't be made.  Join "thread" once the ring is used up.
+ */
+int ring_start_reader(SampleRingPtr ring, FILE *inp, int bit_size, pthread_t *thread);
+
+#endif
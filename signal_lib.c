@@ -0,0 +1,426 @@
+#include "signal_lib.h"
+#include "util.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <math.h>
+
+/*Adler-32 sums are taken mod this prime*/
+#define ADLER_MOD 65521
+/*The most bytes that can be added before the sums have to be reduced*/
+#define ADLER_MAX_RUN 5552
+
+static void adler_block(SignalStatsPtr stats, const unsigned *samples, int count);
+static void channel_block(ChannelStatsPtr s, const unsigned *x, int n, unsigned max_value,
+							int bit_size);
+
+/**
+ * Clears the statistics for a file with the given number of channels and bit size.
+ */
+void stats_init(SignalStatsPtr stats, int channels, int bit_size)
+{
+	int c;
+
+	stats->channels = channels;
+	stats->bit_size = bit_size;
+	stats->mid = 1u << (bit_size - 1);
+	stats->max_value = (bit_size == 32) ? 0xFFFFFFFFu : (1u << bit_size) - 1;
+	for(c=0; c<2; c++)
+	{
+		stats->channel[c].min = stats->max_value;
+		stats->channel[c].max = 0;
+		stats->channel[c].sum = 0;
+		stats->channel[c].ref = 0;
+		stats->channel[c].sum_squares = 0.0;
+		stats->channel[c].zeros = 0;
+		stats->channel[c].clipped_high = 0;
+		stats->channel[c].count = 0;
+	}
+	stats->adler_a = 1;
+	stats->adler_b = 0;
+}
+
+/**
+ * Adds "count" samples (both channels interleaved if there are two) to the statistics.  Stereo
+ * samples are split into one array per channel first so the kernel always works on samples
+ * that are next to each other.  A trailing half frame is ignored.
+ */
+void stats_add(SignalStatsPtr stats, const unsigned *samples, int count)
+{
+	unsigned left[SIGNAL_BLOCK];
+	unsigned right[SIGNAL_BLOCK];
+	int frames = count / stats->channels;
+	int i, j, n;
+
+	adler_block(stats, samples, frames * stats->channels);
+	for(i=0; i<frames; i+=SIGNAL_BLOCK)
+	{
+		n = frames - i;
+		if(n > SIGNAL_BLOCK)
+		{
+			n = SIGNAL_BLOCK;
+		}
+		if(stats->channels == 1)
+		{
+			channel_block(&stats->channel[0], samples + i, n, stats->max_value, stats->bit_size);
+		}
+		else
+		{
+			for(j=0; j<n; j++)
+			{
+				left[j] = samples[2*(i+j)];
+				right[j] = samples[2*(i+j) + 1];
+			}
+			channel_block(&stats->channel[0], left, n, stats->max_value, stats->bit_size);
+			channel_block(&stats->channel[1], right, n, stats->max_value, stats->bit_size);
+		}
+	}
+}
+
+/**
+ * Adds the bytes of the samples to the checksum, in the order they are in the file.
+ */
+static void adler_block(SignalStatsPtr stats, const unsigned *samples, int count)
+{
+	unsigned a = stats->adler_a;
+	unsigned b = stats->adler_b;
+	int bytes_per_sample = stats->bit_size / 8;
+	int per_run = ADLER_MAX_RUN / bytes_per_sample;
+	int i, k, end;
+	unsigned v;
+
+	for(i=0; i<count; i=end)
+	{
+		end = (count - i > per_run) ? i + per_run : count;
+		for(; i<end; i++)
+		{
+			v = samples[i];
+			for(k=0; k<bytes_per_sample; k++)
+			{
+				a += v & 0xFF;
+				b += a;
+				v = v >> 8;
+			}
+		}
+		a = a % ADLER_MOD;
+		b = b % ADLER_MOD;
+	}
+	stats->adler_a = a;
+	stats->adler_b = b;
+}
+
+/**
+ * Adds "n" samples of one channel to its totals.  Each total is kept in eight separate lanes
+ * so the compiler can do eight samples at a time in vector registers, and the lanes are only
+ * added together at the end.  The squares are of each sample's distance from the channel's
+ * first sample, which is near the rest of it, so they stay small.  With 8 and 16 bit samples
+ * they are small enough to add up exactly as integers; 32 bit samples need doubles.
+ */
+static void channel_block(ChannelStatsPtr s, const unsigned *x, int n, unsigned max_value,
+							int bit_size)
+{
+	unsigned lo[8], hi[8];
+	unsigned low[8], high[8];
+	unsigned long long sum[8];
+	unsigned long long sq[8];
+	double dsq[8];
+	int vec_n = n - n % 8;
+	int j, l;
+	long long d;
+	unsigned ref;
+
+	if(s->count == 0 && n > 0)
+	{
+		s->ref = x[0];
+	}
+	ref = s->ref;
+	for(l=0; l<8; l++)
+	{
+		lo[l] = s->min;
+		hi[l] = s->max;
+		low[l] = 0;
+		high[l] = 0;
+		sum[l] = 0;
+		sq[l] = 0;
+		dsq[l] = 0.0;
+	}
+
+	for(j=0; j<vec_n; j+=8)
+	{
+		for(l=0; l<8; l++)
+		{
+			unsigned v = x[j+l];
+			lo[l] = (v < lo[l]) ? v : lo[l];
+			hi[l] = (v > hi[l]) ? v : hi[l];
+			low[l] += (v == 0);
+			high[l] += (v == max_value);
+			sum[l] += v;
+		}
+	}
+	if(bit_size <= 16)
+	{
+		for(j=0; j<vec_n; j+=8)
+		{
+			for(l=0; l<8; l++)
+			{
+				unsigned dist = (x[j+l] > ref) ? x[j+l] - ref : ref - x[j+l];
+				sq[l] += dist * dist;
+			}
+		}
+	}
+	else
+	{
+		for(j=0; j<vec_n; j+=8)
+		{
+			for(l=0; l<8; l++)
+			{
+				double dist = (double)x[j+l] - (double)ref;
+				dsq[l] += dist * dist;
+			}
+		}
+	}
+
+	/*The samples left over after the last group of eight*/
+	for(j=vec_n; j<n; j++)
+	{
+		unsigned v = x[j];
+		lo[0] = (v < lo[0]) ? v : lo[0];
+		hi[0] = (v > hi[0]) ? v : hi[0];
+		low[0] += (v == 0);
+		high[0] += (v == max_value);
+		sum[0] += v;
+		d = (long long)v - (long long)ref;
+		dsq[0] += (double)d * (double)d;
+	}
+
+	for(l=0; l<8; l++)
+	{
+		s->min = (lo[l] < s->min) ? lo[l] : s->min;
+		s->max = (hi[l] > s->max) ? hi[l] : s->max;
+		s->zeros += low[l];
+		s->clipped_high += high[l];
+		s->sum += sum[l];
+		s->sum_squares += (double)sq[l] + dsq[l];
+	}
+	s->count += n;
+}
+
+/**
+ * Reads the data portion of a file whose header has already been parsed, checking it the
+ * same way parse_file does and collecting the statistics of every sample in the same pass.
+ * Returns 0 if no format errors are found and 1 if they are.
+ */
+int parse_file_stats(FILE *inp, FileInfoPtr file_info, SignalStatsPtr stats)
+{
+	unsigned samples[SIGNAL_BLOCK];
+	int bytes_per_sample = file_info->bit_size / 8;
+	int channels = (file_info->mono_or_stereo == STEREO) ? 2 : 1;
+	unsigned num_samples = 0;
+	int bytes_read;
+	int extra_bytes = 0;
+	unsigned long long start;
+
+	stats_init(stats, channels, file_info->bit_size);
+	do
+	{
+		/*Read bytes rather than samples so a partial sample at the end can be caught*/
+		PERF_START(start);
+		bytes_read = fread(samples, 1, SIGNAL_BLOCK * bytes_per_sample, inp);
+		PERF_STOP(PERF_IO_WAIT_NS, "read_block", start);
+		PERF_START(start);
+		unpack_samples(samples, bytes_read / bytes_per_sample, file_info->bit_size);
+		stats_add(stats, samples, bytes_read / bytes_per_sample);
+		PERF_STOP(PERF_COMPUTE_NS, "stats", start);
+		num_samples += bytes_read / bytes_per_sample;
+		extra_bytes = bytes_read % bytes_per_sample;
+	} while(bytes_read == SIGNAL_BLOCK * bytes_per_sample);
+	perf_add(PERF_BYTES_READ, num_samples * bytes_per_sample + extra_bytes);
+	perf_add(PERF_SAMPLES_READ, num_samples);
+	perf_add(PERF_SAMPLES_PROCESSED, num_samples);
+
+	if(extra_bytes != 0)
+	{
+		fprintf(stderr, "The number of bytes of data must be evenly divisible by the bytes per sample.\n");
+		return 1;
+	}
+	if(file_info->mono_or_stereo == STEREO)
+	{
+		if(num_samples % 2 != 0)
+		{
+			fprintf(stderr, "Stereo files must have an even number of samples");
+			return 1;
+		}
+		num_samples = num_samples / 2;
+	}
+	if(file_info->num_samples != 0 && num_samples != file_info->num_samples)
+	{
+		fprintf(stderr, "The number of samples in the file does not match the value in the header.");
+		fprintf(stderr, "Header: %d\nFile: %d",
+					file_info->num_samples, num_samples);
+		return 1;
+	}
+	file_info->num_samples = num_samples;
+	return 0;
+}
+
+/**
+ * The largest distance of any sample in the channel from the channel's mean, rounded.
+ */
+unsigned stats_peak(SignalStatsPtr stats, int channel)
+{
+	ChannelStatsPtr s = &stats->channel[channel];
+	double mean, below, above;
+
+	if(s->count == 0)
+	{
+		return 0;
+	}
+	mean = (double)s->sum / s->count;
+	below = mean - s->min;
+	above = s->max - mean;
+	return (unsigned)(((below > above) ? below : above) + 0.5);
+}
+
+/**
+ * The root mean square distance of the channel's samples from their mean.  The squares were
+ * added up about the first sample, and moving them to the mean takes off the square of the
+ * mean's distance from it.
+ */
+double stats_rms(SignalStatsPtr stats, int channel)
+{
+	ChannelStatsPtr s = &stats->channel[channel];
+	double offset, variance;
+
+	if(s->count == 0)
+	{
+		return 0.0;
+	}
+	offset = (double)s->sum / s->count - s->ref;
+	variance = s->sum_squares / s->count - offset * offset;
+	return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+/**
+ * The DC offset of the channel, which is the mean of its samples.
+ */
+double stats_dc_offset(SignalStatsPtr stats, int channel)
+{
+	ChannelStatsPtr s = &stats->channel[channel];
+
+	if(s->count == 0)
+	{
+		return 0.0;
+	}
+	return (double)s->sum / s->count;
+}
+
+/**
+ * The 0's only count when the channel is centred in the range.  See signal_lib.h.
+ */
+unsigned long long stats_clipped_low(SignalStatsPtr stats, int channel)
+{
+	ChannelStatsPtr s = &stats->channel[channel];
+
+	if(s->count == 0 || (double)s->sum / s->count < stats->mid)
+	{
+		return 0;
+	}
+	return s->zeros;
+}
+
+/**
+ * Converts a level to decibels relative to full scale, where full scale is the middle value,
+ * half the range.
+ */
+double stats_dbfs(SignalStatsPtr stats, double level)
+{
+	return 20.0 * log10(level / stats->mid);
+}
+
+/**
+ * Stores the peak, RMS and checksum of the whole file (all channels together) in the header
+ * fields of "file_info" and marks them as present.  The peak is the largest sample value.
+ */
+void stats_to_header(SignalStatsPtr stats, FileInfoPtr file_info)
+{
+	double sum_squares = 0.0;
+	double rms;
+	unsigned long long count = 0;
+	int c;
+
+	file_info->peak = 0;
+	for(c=0; c<stats->channels; c++)
+	{
+		if(stats->channel[c].count > 0 && stats->channel[c].max > file_info->peak)
+		{
+			file_info->peak = stats->channel[c].max;
+		}
+		/*Each channel about its own mean*/
+		rms = stats_rms(stats, c);
+		sum_squares += rms * rms * stats->channel[c].count;
+		count += stats->channel[c].count;
+	}
+	file_info->rms = (count > 0) ? sqrt(sum_squares / count) : 0.0;
+	file_info->checksum = (stats->adler_b << 16) | stats->adler_a;
+	file_info->header_stats = HEADER_ALL_STATS;
+}
+
+/**
+ * Checks the statistics that were in the file's header against the ones that were worked
+ * out from its data.  The RMS is written with a few decimal places, so it only has to be
+ * close.  Returns 0 if they all match and 1 if any don't.
+ */
+int check_header_stats(SignalStatsPtr stats, FileInfoPtr file_info)
+{
+	FileInfo actual;
+
+	stats_to_header(stats, &actual);
+	if((file_info->header_stats & HEADER_PEAK) && file_info->peak != actual.peak)
+	{
+		return 1;
+	}
+	if((file_info->header_stats & HEADER_RMS) && fabs(file_info->rms - actual.rms) > 0.01)
+	{
+		return 1;
+	}
+	if((file_info->header_stats & HEADER_CHECKSUM) && file_info->checksum != actual.checksum)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Writes a header with the information in "file_info", including any statistics it has.  The
+ * SAMPLE field is left out if "show_samples" is 0.
+ */
+void write_stats_header(FILE *out, FileInfoPtr file_info, int show_samples)
+{
+	fprintf(out, "Header\n");
+	fprintf(out, "FREQUENCY %d\n", file_info->frequency);
+	if(show_samples)
+	{
+		fprintf(out, "SAMPLE %d\n", file_info->num_samples);
+	}
+	if(file_info->mono_or_stereo == MONO)
+	{
+		fprintf(out, "CHANNELS MONO\n");
+	}
+	else
+	{
+		fprintf(out, "CHANNELS STEREO\n");
+	}
+	fprintf(out, "SAMPLEBITS %d\n", file_info->bit_size);
+	if(file_info->header_stats & HEADER_PEAK)
+	{
+		fprintf(out, "PEAK %u\n", file_info->peak);
+	}
+	if(file_info->header_stats & HEADER_RMS)
+	{
+		fprintf(out, "RMS %.4f\n", file_info->rms);
+	}
+	if(file_info->header_stats & HEADER_CHECKSUM)
+	{
+		fprintf(out, "CHECKSUM %08x\n", file_info->checksum);
+	}
+	fprintf(out, "EndHeader\n");
+}
@@ -0,0 +1,117 @@
+#ifndef SIGNAL_LIB_H_
+#define SIGNAL_LIB_H_
+
+#include <stdio.h>
+#include "input_lib.h"
+
+/*Number of frames looked at in each pass of the statistics kernels*/
+#define SIGNAL_BLOCK 4096
+
+typedef struct channel_stats *ChannelStatsPtr;
+
+/**
+ * Running totals for one channel.  Everything else (peak, RMS, DC offset) is worked out from
+ * these once the whole file has been seen.
+ */
+typedef struct channel_stats
+{
+	unsigned min;
+	unsigned max;
+	unsigned long long sum;
+	unsigned ref;			/*The channel's first sample*/
+	double sum_squares;		/*Of each sample's distance from ref, which keeps them small;
+							the RMS about the mean is worked out from it*/
+	unsigned long long zeros;			/*Samples equal to 0*/
+	unsigned long long clipped_high;	/*Samples equal to 2^bit_size - 1*/
+	unsigned long long count;
+} ChannelStats;
+
+typedef struct signal_stats *SignalStatsPtr;
+
+/**
+ * Statistics for every channel of a file.  Samples are unsigned and the tools here write them
+ * from 0 up: gensine's tone runs from 0 to its amplitude, and the pauses of gendtmf and merge
+ * are 0's.  So nothing is measured from a fixed silence level.  The DC offset is the mean of a
+ * channel's samples, and the peak and RMS are measured from that mean, so they give the size
+ * of the signal wherever it sits in the range.  Levels in dBFS are relative to half the range
+ * (the middle value 2^(bit_size-1)), the largest peak a signal can have about its mean.
+ *
+ * A sample at 2^bit_size - 1 is always clipped.  A sample at 0 is only counted as clipped when
+ * the channel is centred in the range (its mean at or above the middle value), since for
+ * anything quieter 0 is where the troughs and silence sit rather than a rail.
+ */
+typedef struct signal_stats
+{
+	int channels;
+	int bit_size;
+	unsigned mid;
+	unsigned max_value;
+	ChannelStats channel[2];
+	unsigned adler_a;		/*The two halves of the Adler-32 checksum of the data bytes*/
+	unsigned adler_b;
+} SignalStats;
+
+/**
+ * Clears the statistics for a file with the given number of channels and bit size.
+ */
+void stats_init(SignalStatsPtr stats, int channels, int bit_size);
+
+/**
+ * Adds "count" samples (both channels interleaved if there are two) to the statistics.
+ */
+void stats_add(SignalStatsPtr stats, const unsigned *samples, int count);
+
+/**
+ * Reads the data portion of a file whose header has already been parsed, checking it the
+ * same way parse_file does and collecting the statistics of every sample in the same pass.
+ * Returns 0 if no format errors are found and 1 if they are.
+ */
+int parse_file_stats(FILE *inp, FileInfoPtr file_info, SignalStatsPtr stats);
+
+/**
+ * The largest distance of any sample in the channel from the channel's mean, rounded.
+ */
+unsigned stats_peak(SignalStatsPtr stats, int channel);
+
+/**
+ * The root mean square distance of the channel's samples from their mean.
+ */
+double stats_rms(SignalStatsPtr stats, int channel);
+
+/**
+ * The DC offset of the channel, which is the mean of its samples.
+ */
+double stats_dc_offset(SignalStatsPtr stats, int channel);
+
+/**
+ * The number of the channel's samples clipped against the bottom of the range.  See
+ * SignalStats for when a 0 counts.
+ */
+unsigned long long stats_clipped_low(SignalStatsPtr stats, int channel);
+
+/**
+ * Converts a level (a peak or RMS) to decibels relative to full scale.
+ */
+double stats_dbfs(SignalStatsPtr stats, double level);
+
+/**
+ * Stores the peak, RMS and checksum of the whole file (all channels together) in the header
+ * fields of "file_info" and marks them as present.  The header's peak is the largest sample
+ * value, not a distance from the mean, so a reader like mix can scale by it without reading
+ * the data.  The RMS is about each channel's mean, the same as stats_rms.
+ */
+void stats_to_header(SignalStatsPtr stats, FileInfoPtr file_info);
+
+/**
+ * Checks the statistics that were in the file's header against the ones that were worked
+ * out from its data.  Returns 0 if they all match and 1 if any don't.
+ */
+int check_header_stats(SignalStatsPtr stats, FileInfoPtr file_info);
+
+/**
+ * Writes a header with the information in "file_info", including any statistics it has.  The
+ * SAMPLE field is left out if "show_samples" is 0.
+ */
+void write_stats_header(FILE *out, FileInfoPtr file_info, int show_samples);
+
+#endif
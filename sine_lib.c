@@ -1,35 +1,179 @@
 #include "sine_lib.h"
 #include "util.h"
+#include "perf_lib.h"
 #include <math.h>
 #include <stdio.h>
 
+/*The sine table has 2^TABLE_BITS entries over one cycle*/
+#define TABLE_BITS 12
+#define TABLE_SIZE (1<<TABLE_BITS)
+#define TABLE_MASK (TABLE_SIZE-1)
+
+static double sine_table[TABLE_SIZE];
+static int table_ready = 0;
+
+static double table_sin(unsigned long long phase);
+
+/**
+ * Calculates the sine table if it hasn't been already.
+ */
+void sine_table_init(void)
+{
+	int i;
+	
+	if(table_ready == 0)
+	{
+		for(i=0; i<TABLE_SIZE; i++)
+		{
+			sine_table[i] = sin((2.0*M_PI*i) / TABLE_SIZE);
+		}
+		table_ready = 1;
+	}
+}
+
+/**
+ * Sets up the oscillator for a wave of the given frequency, starting at phase 0.
+ */
+void osc_init(OscillatorPtr osc, double frequency, int sample_rate)
+{
+	/*The table is only calculated the first time it's needed*/
+	sine_table_init();
+	
+	osc->phase = 0;
+	/*2^64 * frequency / sample_rate, split up so nothing overflows a double's range*/
+	osc->step = (unsigned long long)(ldexp(frequency / sample_rate, 64));
+}
+
+/**
+ * Fills "out" with the next "count" values of sin() for the oscillator and moves it along.
+ */
+void osc_fill(OscillatorPtr osc, double *out, int count)
+{
+	unsigned long long phase = osc->phase;
+	unsigned long long step = osc->step;
+	int i;
+	
+	for(i=0; i<count; i++)
+	{
+		out[i] = table_sin(phase + step*i);
+	}
+	osc->phase = phase + step*count;
+}
+
+/**
+ * Fills "out" with sin() of each of the phases, which are fixed point fractions of a cycle
+ * like the oscillator's.  sine_table_init() must have been called first.
+ */
+void phase_sin(const unsigned long long *phases, double *out, int count)
+{
+	int i;
+	for(i=0; i<count; i++)
+	{
+		out[i] = table_sin(phases[i]);
+	}
+}
+
+/**
+ * Returns sin() of the phase.  The top bits of the phase pick an entry in the table, and the
+ * rest is the small angle past it.  sin(a+b) = sin(a)cos(b) + cos(a)sin(b), and since b is
+ * tiny a few terms of the Taylor series for cos(b) and sin(b) give full double precision
+ * without calling sin().
+ */
+static double table_sin(unsigned long long phase)
+{
+	const double frac_to_radians = 2.0*M_PI / 18446744073709551616.0;
+	unsigned index = (unsigned)(phase >> (64 - TABLE_BITS));
+	double b = (double)(phase & ((1ULL << (64 - TABLE_BITS)) - 1)) * frac_to_radians;
+	double b2 = b*b;
+	double sin_a = sine_table[index];
+	double cos_a = sine_table[(index + TABLE_SIZE/4) & TABLE_MASK];
+	
+	return sin_a*(1.0 - b2*(0.5 - b2/24.0)) + cos_a*b*(1.0 - b2/6.0);
+}
+
+/**
+ * Fills "out" with the next "count" samples of the wave described by "sin_prop_ptr", using the
+ * oscillator to keep track of where the wave is.  Only one channel is filled.
+ */
+void fill_wave(SinePropPtr sin_prop_ptr, OscillatorPtr osc, unsigned *out, int count)
+{
+	unsigned half_amp = sin_prop_ptr->amplitude/2;
+	double values[WAVE_BLOCK];
+	int i, j, n;
+	
+	for(i=0; i<count; i+=WAVE_BLOCK)
+	{
+		n = count - i;
+		if(n > WAVE_BLOCK)
+		{
+			n = WAVE_BLOCK;
+		}
+		osc_fill(osc, values, n);
+		for(j=0; j<n; j++)
+		{
+			out[i+j] = (unsigned)(values[j]*half_amp + half_amp);
+		}
+	}
+}
+
 /**
- * Print the wave described by "sin_prop_ptr"
+ * Print the wave described by "sin_prop_ptr" to standard output.
  */
 void print_wave(SinePropPtr sin_prop_ptr)
 {
-	double samples_per_cycle;
+	write_wave(stdout, sin_prop_ptr);
+}
+
+/**
+ * Write the wave described by "sin_prop_ptr" to "out".  The wave is generated a block at a
+ * time and each block is written out at once.
+ */
+void write_wave(FILE *out, SinePropPtr sin_prop_ptr)
+{
 	int number_of_samples;
-	double cur_radian = 0.0;
-	int i=0;
-	unsigned result;
+	int i, count;
+	unsigned result[2*WAVE_BLOCK];
+	Oscillator osc;
+	unsigned long long perf_start;
 	
-	samples_per_cycle = (double)(sin_prop_ptr->sample_rate) / (sin_prop_ptr->frequency);
 	number_of_samples = (sin_prop_ptr->sample_rate) * (sin_prop_ptr->duration);
+	osc_init(&osc, sin_prop_ptr->frequency, sin_prop_ptr->sample_rate);
 	
 	/*Do the math to calculate the values for the described sine wave*/
-	for(i=0; i<number_of_samples; i++)
+	for(i=0; i<number_of_samples; i+=WAVE_BLOCK)
 	{
-		result = (unsigned)((sin(cur_radian))*(sin_prop_ptr->amplitude/2) + 
-													(sin_prop_ptr->amplitude/2));
-		if(sin_prop_ptr->mono_or_stereo == STEREO)
-		{
-			/*Print out two channels of the same amplitude*/
-			output_sample(stdout, result, sin_prop_ptr->bit_size);
-		}
-		output_sample(stdout, result, sin_prop_ptr->bit_size);
-		cur_radian += 2*M_PI / (samples_per_cycle);
+		PERF_START(perf_start);
+		count = wave_block(sin_prop_ptr, &osc, result, number_of_samples - i);
+		PERF_STOP(PERF_COMPUTE_NS, "wave_block", perf_start);
+		perf_add(PERF_SAMPLES_PROCESSED, count);
+		output_samples(out, result, count, sin_prop_ptr->bit_size);
 	}
 	
 	return;
 }
+
+/**
+ * Fills "out" with the next block of the wave, up to WAVE_BLOCK frames but no more than
+ * "frames_left".  Both channels are filled for STEREO, so "out" must hold 2*WAVE_BLOCK values.
+ * Returns the number of values filled in.
+ */
+int wave_block(SinePropPtr sin_prop_ptr, OscillatorPtr osc, unsigned *out, int frames_left)
+{
+	int count = (frames_left > WAVE_BLOCK) ? WAVE_BLOCK : frames_left;
+	int j;
+	
+	fill_wave(sin_prop_ptr, osc, out, count);
+	if(sin_prop_ptr->mono_or_stereo != STEREO)
+	{
+		return count;
+	}
+	
+	/*Two channels of the same amplitude, working backwards so the mono values aren't
+	overwritten before they are copied*/
+	for(j=count-1; j>=0; j--)
+	{
+		out[2*j+1] = out[j];
+		out[2*j] = out[j];
+	}
+	return 2*count;
+}
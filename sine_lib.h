@@ -1,9 +1,14 @@
 #ifndef SINE_LIB_H_
 #define SINE_LIB_H_
 
+#include <stdio.h>
+
 #define MONO 0
 #define STEREO 1
 
+/*Number of frames generated at a time before being written out*/
+#define WAVE_BLOCK 4096
+
 typedef struct sine_properties *SinePropPtr;
 
 /**
@@ -19,9 +24,61 @@ typedef struct sine_properties
 	double duration;
 } SineProp;
 
+typedef struct oscillator *OscillatorPtr;
+
+/**
+ * A phase accumulator.  The phase is a 64-bit fixed point fraction of a cycle, so it wraps
+ * around on its own and never drifts no matter how long the wave is.
+ */
+typedef struct oscillator
+{
+	unsigned long long phase;
+	unsigned long long step;	/*Amount the phase moves each sample*/
+} Oscillator;
+
+/**
+ * Calculates the sine table used by the oscillators if it hasn't been already.  osc_init calls
+ * this, but programs with threads should call it before starting them.
+ */
+void sine_table_init(void);
+
+/**
+ * Sets up the oscillator for a wave of the given frequency, starting at phase 0.
+ */
+void osc_init(OscillatorPtr osc, double frequency, int sample_rate);
+
+/**
+ * Fills "out" with the next "count" values of sin() for the oscillator and moves it along.
+ */
+void osc_fill(OscillatorPtr osc, double *out, int count);
+
+/**
+ * Fills "out" with sin() of each of the phases, which are fixed point fractions of a cycle
+ * like the oscillator's.  sine_table_init() must have been called first.
+ */
+void phase_sin(const unsigned long long *phases, double *out, int count);
+
+/**
+ * Fills "out" with the next "count" samples of the wave described by "sin_prop_ptr", using the
+ * oscillator to keep track of where the wave is.  Only one channel is filled.
+ */
+void fill_wave(SinePropPtr sin_prop_ptr, OscillatorPtr osc, unsigned *out, int count);
+
+/**
+ * Fills "out" with the next block of the wave, up to WAVE_BLOCK frames but no more than
+ * "frames_left".  Both channels are filled for STEREO, so "out" must hold 2*WAVE_BLOCK values.
+ * Returns the number of values filled in.
+ */
+int wave_block(SinePropPtr sin_prop_ptr, OscillatorPtr osc, unsigned *out, int frames_left);
+
 /**
  * Print the wave described by the "sin_prop_ptr" structure.
  */
 void print_wave(SinePropPtr sin_prop_ptr);
 
+/**
+ * Write the wave described by the "sin_prop_ptr" structure to "out".
+ */
+void write_wave(FILE *out, SinePropPtr sin_prop_ptr);
+
 #endif
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*Longest request line, the same as soundd*/
+#define MAX_REQUEST 4096
+/*Longest reply that is read*/
+#define MAX_REPLY 4096
+
+/**
+ * Soundc
+ * Sends one job to soundd and waits for it to be done.  The arguments after the socket are
+ * the request, the same as a line of soundd's protocol, and this program's standard input and
+ * output are passed along with it, so "-" as a job's input or output means standard input or
+ * output here.  The reply is written to stderr, or to standard output for "stats".
+ *
+ * Some examples:
+ *	soundc /tmp/soundd.sock dtmf - - < tones.snd
+ *	soundc /tmp/soundd.sock generate - MONO 440 16 8000 10000 1 > a.snd
+ *	soundc /tmp/soundd.sock mix out.snd a.snd 1.0 b.snd 0.5
+ *
+ * Command Line Variables: soundc <socket path> <job> [arguments ...]
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	struct sockaddr_un addr;
+	union
+	{
+		struct cmsghdr header;
+		char space[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	int fds[2] = {STDIN_FILENO, STDOUT_FILENO};
+	char request[MAX_REQUEST];
+	char reply[MAX_REPLY];
+	int length = 0;
+	int sock, got, i;
+
+	if(argc < 3)
+	{
+		fprintf(stderr, "You must give the path of the socket and the job.\n");
+		return 1;
+	}
+	if(strlen(argv[1]) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "The socket path is too long: %s\n", argv[1]);
+		return 1;
+	}
+
+	/*Join the arguments back into a request line*/
+	for(i=2; i<argc; i++)
+	{
+		if(length + strlen(argv[i]) + 2 > MAX_REQUEST)
+		{
+			fprintf(stderr, "The request is too long.\n");
+			return 1;
+		}
+		length += sprintf(request + length, "%s%s", argv[i], (i < argc - 1) ? " " : "\n");
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, argv[1]);
+	if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+			connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{
+		fprintf(stderr, "Cannot connect to: %s\n", argv[1]);
+		return 1;
+	}
+
+	/*The descriptors go with the request line*/
+	iov.iov_base = request;
+	iov.iov_len = length;
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.space;
+	msg.msg_controllen = sizeof(control.space);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	if(sendmsg(sock, &msg, 0) != length)
+	{
+		fprintf(stderr, "Cannot send the request.\n");
+		close(sock);
+		return 1;
+	}
+
+	/*The reply comes once the job is done, and then soundd closes the connection*/
+	length = 0;
+	while(length < MAX_REPLY - 1 && (got = read(sock, reply + length, MAX_REPLY - 1 - length)) > 0)
+	{
+		length += got;
+	}
+	reply[length] = '\0';
+	close(sock);
+
+	if(strcmp(argv[2], "stats") == 0)
+	{
+		printf("%s", reply);
+		return (length > 0) ? 0 : 1;
+	}
+	fprintf(stderr, "%s", reply);
+	return (strncmp(reply, "OK", 2) == 0) ? 0 : 1;
+}
@@ -0,0 +1,769 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "info_lib.h"
+#include "mix_lib.h"
+#include "reverb_lib.h"
+#include "dtmf_lib.h"
+#include "gensine_lib.h"
+#include "pool_lib.h"
+#include "perf_lib.h"
+
+/*Longest request line*/
+#define MAX_REQUEST 4096
+#define MAX_WORDS 256
+/*Descriptors a request can pass: an input and an output*/
+#define MAX_FDS 2
+/*How long a client has from connecting to send its whole request line before it's dropped*/
+#define REQUEST_TIMEOUT_SEC 5
+/*Connections whose request lines are still being read.  Once this many are waiting no more
+are accepted until one is done.*/
+#define MAX_PENDING 64
+
+/*Kinds of jobs, in the order of job_names*/
+#define JOB_INFO 0
+#define JOB_MIX 1
+#define JOB_REVERB 2
+#define JOB_DTMF 3
+#define JOB_GENERATE 4
+#define NUM_JOBS 5
+
+static const char *job_names[NUM_JOBS] = {"info", "mix", "reverb", "dtmf", "generate"};
+
+typedef struct sound_request *SoundRequestPtr;
+
+/**
+ * One request: the client's connection, the words of its request line and the descriptors
+ * it passed.  A descriptor is set to -1 once a job has taken it.
+ */
+typedef struct sound_request
+{
+	int sock;
+	int fds[MAX_FDS];
+	int num_fds;
+	char line[MAX_REQUEST];
+	int length;							/*Bytes of the line read so far*/
+	char *words[MAX_WORDS];
+	int num_words;
+	unsigned long long deadline;		/*perf_now() by when the whole line must be read*/
+	unsigned long long received;		/*perf_now() when the request was read*/
+} SoundRequest;
+
+/**
+ * Latency totals for one kind of job, in nanoseconds from the request being read to the
+ * reply being sent.
+ */
+typedef struct job_latency
+{
+	unsigned long long count;
+	unsigned long long failed;
+	unsigned long long total_ns;
+	unsigned long long max_ns;
+} JobLatency;
+
+static JobLatency latencies[NUM_JOBS];
+static pthread_mutex_t latency_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int jobs_running = 0;
+static volatile sig_atomic_t stopping = 0;
+
+int listen_on(const char *path);
+void stop(int signal_number);
+SoundRequestPtr new_request(int sock);
+int read_request(SoundRequestPtr req);
+void run_request(void *arg);
+int run_job(SoundRequestPtr req, int job);
+int job_info(SoundRequestPtr req);
+int job_mix(SoundRequestPtr req);
+int job_reverb(SoundRequestPtr req);
+int job_dtmf(SoundRequestPtr req);
+int job_generate(SoundRequestPtr req);
+FILE *open_input(SoundRequestPtr req, const char *name);
+FILE *open_output(SoundRequestPtr req, const char *name);
+void send_stats(SoundRequestPtr req);
+void send_reply(int sock, const char *reply);
+void free_request(SoundRequestPtr req);
+
+/**
+ * Soundd
+ * Runs the sound tools as jobs in one long running process, so a service that uses them a lot
+ * doesn't pay for starting a process and loading it for every request.  It listens on a Unix
+ * socket, and each connection sends one request line:
+ *
+ *	info <input> <output> [-json | -csv] [-trust]
+ *	mix <output> <input1> <gain1> [<input2> <gain2> ...]
+ *	reverb <input> <output> <delay1> <attenuation1> [<delay2> <attenuation2> ...]
+ *	dtmf <input> <output>
+ *	generate <output> <MONO | STEREO> <frequency> <bit-size> <sample rate> <amplitude> <duration>
+ *	stats
+ *
+ * Each job does the same thing as the program it's named after (generate is gensine).  Inputs
+ * and outputs are paths, or "-" for a descriptor passed along with the request (SCM_RIGHTS):
+ * the first one passed is the input and the second the output.  The inputs of mix have to be
+ * paths since it reads them twice.  Paths can't have spaces in them.
+ *
+ * The jobs run on the thread pool, so as many run at once as there are CPUs.  When a job is
+ * done its output is closed and the reply is sent, one line of "OK <microseconds>" or
+ * "ERROR <microseconds>", where the time is from the request being read to the job being
+ * done, so it includes any wait for a free thread.  Error messages go to the daemon's stderr.
+ * "stats" replies with the number of jobs of each kind, how many failed and their average and
+ * longest times as one line of JSON.
+ *
+ * The request lines are read by the main thread, which waits on all the connections at once
+ * with poll, so a client that is slow to send its request doesn't hold up anyone else's.  A
+ * client that hasn't sent its whole line 5 seconds after connecting is dropped.
+ *
+ * SIGINT or SIGTERM stops it once the running jobs are done, and removes the socket.
+ *
+ * Command Line Variables: soundd [-j threads] <socket path>
+ * Return Values: 0 - Success; 1 - Failure (error written to stderr)
+ */
+int main(int argc, char *argv[])
+{
+	struct sigaction action;
+	struct pollfd polls[MAX_PENDING + 1];
+	SoundRequestPtr pending[MAX_PENDING];
+	unsigned long long now, first;
+	const char *path;
+	int num_pending = 0;
+	int sock, client, wait_ms, state, i;
+
+	perf_init(&argc, argv);
+
+	if(argc == 4 && strcmp(argv[1], "-j") == 0)
+	{
+		pool_init(atoi(argv[2]));
+		argv += 2;
+		argc -= 2;
+	}
+	if(argc != 2)
+	{
+		fprintf(stderr, "You must give the path of the socket.\n");
+		return 1;
+	}
+	path = argv[1];
+
+	/*The tables used by the jobs are made before any of them start*/
+	sine_table_init();
+	pool_size();
+
+	if((sock = listen_on(path)) < 0)
+	{
+		return 1;
+	}
+
+	/*No SA_RESTART, so poll returns when a signal comes in.  A client that goes away
+	before its reply is sent shouldn't kill the daemon.*/
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	while(!stopping)
+	{
+		/*The listening socket is only watched while there's room for another connection.  poll
+		skips negative descriptors.*/
+		polls[0].fd = (num_pending < MAX_PENDING) ? sock : -1;
+		polls[0].events = POLLIN;
+		first = 0;
+		for(i=0; i<num_pending; i++)
+		{
+			polls[i+1].fd = pending[i]->sock;
+			polls[i+1].events = POLLIN;
+			polls[i+1].revents = 0;
+			if(first == 0 || pending[i]->deadline < first)
+			{
+				first = pending[i]->deadline;
+			}
+		}
+		wait_ms = -1;
+		if(num_pending > 0)
+		{
+			now = perf_now();
+			wait_ms = (first > now) ? (int)((first - now) / 1000000 + 1) : 0;
+		}
+		if(poll(polls, num_pending + 1, wait_ms) < 0)
+		{
+			if(errno != EINTR)
+			{
+				perror("poll");
+			}
+			continue;
+		}
+
+		/*Backwards, so taking one out by moving the last one into its place doesn't skip any*/
+		now = perf_now();
+		for(i=num_pending-1; i>=0; i--)
+		{
+			state = 0;
+			if(polls[i+1].revents != 0)
+			{
+				state = read_request(pending[i]);
+			}
+			if(state == 0 && now >= pending[i]->deadline)
+			{
+				state = -1;
+			}
+			if(state == 1)
+			{
+				atomic_fetch_add(&jobs_running, 1);
+				pool_spawn(run_request, pending[i]);
+			}
+			else if(state < 0)
+			{
+				free_request(pending[i]);
+			}
+			if(state != 0)
+			{
+				pending[i] = pending[--num_pending];
+			}
+		}
+
+		if(polls[0].revents & POLLIN)
+		{
+			/*The listening socket doesn't block, in case the client has already gone*/
+			if((client = accept(sock, NULL, NULL)) >= 0)
+			{
+				pending[num_pending++] = new_request(client);
+			}
+			else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				perror("accept");
+			}
+		}
+	}
+
+	for(i=0; i<num_pending; i++)
+	{
+		free_request(pending[i]);
+	}
+	close(sock);
+	unlink(path);
+	while(atomic_load(&jobs_running) > 0)
+	{
+		usleep(1000);
+	}
+	return 0;
+}
+
+/**
+ * Makes the socket and starts listening on it.  A socket file left behind by a daemon that
+ * didn't stop cleanly is removed first.  Returns the socket, or -1 if it can't be made.
+ */
+int listen_on(const char *path)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	if(strlen(path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "The socket path is too long: %s\n", path);
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	{
+		perror("socket");
+		return -1;
+	}
+	unlink(path);
+	if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, SOMAXCONN) != 0 ||
+			fcntl(sock, F_SETFL, O_NONBLOCK) != 0)
+	{
+		fprintf(stderr, "Cannot listen on: %s\n", path);
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+/**
+ * Signal handler for SIGINT and SIGTERM.
+ */
+void stop(int signal_number)
+{
+	stopping = 1;
+}
+
+/**
+ * Makes the request for a new connection.  Nothing is read yet.
+ */
+SoundRequestPtr new_request(int sock)
+{
+	SoundRequestPtr req = (SoundRequestPtr)perf_malloc(sizeof(SoundRequest));
+
+	req->sock = sock;
+	req->num_fds = 0;
+	req->length = 0;
+	req->num_words = 0;
+	req->deadline = perf_now() + REQUEST_TIMEOUT_SEC * 1000000000ull;
+	return req;
+}
+
+/**
+ * Reads whatever part of the request line has arrived, without waiting for more, along with
+ * any descriptors passed with it.  Once the whole line is there it's split into words.
+ * Returns 1 if the request is complete, 0 if more is still to come and -1 if the client
+ * closed the connection, sent too much or something went wrong.
+ */
+int read_request(SoundRequestPtr req)
+{
+	union
+	{
+		struct cmsghdr header;
+		char space[CMSG_SPACE(MAX_FDS * sizeof(int))];
+	} control;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char *save_ptr;
+	char *word;
+	int got, fd, i;
+
+	if(req->length == MAX_REQUEST - 1)
+	{
+		fprintf(stderr, "Request too long.\n");
+		return -1;
+	}
+	iov.iov_base = req->line + req->length;
+	iov.iov_len = MAX_REQUEST - 1 - req->length;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.space;
+	msg.msg_controllen = sizeof(control.space);
+	if((got = recvmsg(req->sock, &msg, MSG_DONTWAIT)) < 0)
+	{
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	}
+	if(got == 0)
+	{
+		return -1;
+	}
+	req->length += got;
+
+	/*The descriptors come with the first bytes of the line, but the line can arrive in pieces*/
+	for(cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		{
+			got = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for(i=0; i<got; i++)
+			{
+				memcpy(&fd, CMSG_DATA(cmsg) + i*sizeof(int), sizeof(int));
+				if(req->num_fds < MAX_FDS)
+				{
+					req->fds[req->num_fds++] = fd;
+				}
+				else
+				{
+					/*More than we can use, so they're closed right away*/
+					close(fd);
+				}
+			}
+		}
+	}
+	if(req->line[req->length-1] != '\n')
+	{
+		return 0;
+	}
+
+	req->line[req->length-1] = '\0';
+	req->received = perf_now();
+	word = strtok_r(req->line, " \t\r", &save_ptr);
+	while(word != NULL && req->num_words < MAX_WORDS)
+	{
+		req->words[req->num_words++] = word;
+		word = strtok_r(NULL, " \t\r", &save_ptr);
+	}
+	return 1;
+}
+
+/**
+ * Pool task for one request.  Runs the job, then sends the reply and records how long it
+ * took.
+ */
+void run_request(void *arg)
+{
+	SoundRequestPtr req = (SoundRequestPtr)arg;
+	unsigned long long elapsed;
+	char reply[64];
+	int job = -1;
+	int result = 1;
+	int i;
+
+	for(i=0; i<NUM_JOBS && req->num_words > 0; i++)
+	{
+		if(strcmp(req->words[0], job_names[i]) == 0)
+		{
+			job = i;
+		}
+	}
+
+	if(req->num_words == 1 && strcmp(req->words[0], "stats") == 0)
+	{
+		send_stats(req);
+	}
+	else if(job < 0)
+	{
+		fprintf(stderr, "Unknown job: %s\n", (req->num_words > 0) ? req->words[0] : "");
+		send_reply(req->sock, "ERROR 0\n");
+	}
+	else
+	{
+		result = run_job(req, job);
+		elapsed = perf_now() - req->received;
+		pthread_mutex_lock(&latency_lock);
+		latencies[job].count++;
+		latencies[job].failed += (result != 0);
+		latencies[job].total_ns += elapsed;
+		if(elapsed > latencies[job].max_ns)
+		{
+			latencies[job].max_ns = elapsed;
+		}
+		pthread_mutex_unlock(&latency_lock);
+		sprintf(reply, "%s %llu\n", (result == 0) ? "OK" : "ERROR", elapsed / 1000);
+		send_reply(req->sock, reply);
+	}
+
+	free_request(req);
+	atomic_fetch_sub(&jobs_running, 1);
+}
+
+/**
+ * Runs one job.  Returns 0 on success and 1 on failure.
+ */
+int run_job(SoundRequestPtr req, int job)
+{
+	if(job == JOB_INFO)
+	{
+		return job_info(req);
+	}
+	else if(job == JOB_MIX)
+	{
+		return job_mix(req);
+	}
+	else if(job == JOB_REVERB)
+	{
+		return job_reverb(req);
+	}
+	else if(job == JOB_DTMF)
+	{
+		return job_dtmf(req);
+	}
+	return job_generate(req);
+}
+
+/**
+ * info <input> <output> [-json | -csv] [-trust]
+ */
+int job_info(SoundRequestPtr req)
+{
+	InfoJob info;
+	FILE *inp, *out;
+	int json = 0, csv = 0, trust = 0;
+	int i;
+
+	if(req->num_words < 3)
+	{
+		fprintf(stderr, "info needs an input and an output.\n");
+		return 1;
+	}
+	for(i=3; i<req->num_words; i++)
+	{
+		json |= (strcmp(req->words[i], "-json") == 0);
+		csv |= (strcmp(req->words[i], "-csv") == 0);
+		trust |= (strcmp(req->words[i], "-trust") == 0);
+	}
+	if((inp = open_input(req, req->words[1])) == NULL)
+	{
+		return 1;
+	}
+	if((out = open_output(req, req->words[2])) == NULL)
+	{
+		fclose(inp);
+		return 1;
+	}
+
+	info.path = req->words[1];
+	strncpy(info.info.file_name, info.path, MAX_FILE_NAME_LEN - 1);
+	info.info.file_name[MAX_FILE_NAME_LEN - 1] = '\0';
+	info.valid = (info_analyze(inp, &info, trust) == 0);
+	if(json)
+	{
+		info_print_json(out, &info);
+	}
+	else if(csv)
+	{
+		info_print_csv_header(out);
+		info_print_csv(out, &info);
+	}
+	else if(info.valid)
+	{
+		info_print_text(out, &info, 1);
+	}
+	fclose(inp);
+	fclose(out);
+	return info.valid ? 0 : 1;
+}
+
+/**
+ * mix <output> <input1> <gain1> [<input2> <gain2> ...]
+ */
+int job_mix(SoundRequestPtr req)
+{
+	const char **paths;
+	double *gains;
+	FILE *out;
+	int num_files, i;
+	int result;
+
+	if(req->num_words < 4 || (req->num_words - 2) % 2 != 0)
+	{
+		fprintf(stderr, "mix needs an output and then a gain for each input.\n");
+		return 1;
+	}
+	num_files = (req->num_words - 2) / 2;
+	for(i=0; i<num_files; i++)
+	{
+		if(strcmp(req->words[2 + 2*i], "-") == 0)
+		{
+			fprintf(stderr, "The inputs of mix must be paths.\n");
+			return 1;
+		}
+	}
+	if((out = open_output(req, req->words[1])) == NULL)
+	{
+		return 1;
+	}
+
+	paths = (const char**)perf_malloc(num_files * sizeof(char*));
+	gains = (double*)perf_malloc(num_files * sizeof(double));
+	for(i=0; i<num_files; i++)
+	{
+		paths[i] = req->words[2 + 2*i];
+		gains[i] = atof(req->words[3 + 2*i]);
+	}
+	result = mix_paths(paths, gains, num_files, out);
+	free(paths);
+	free(gains);
+	fclose(out);
+	return result;
+}
+
+/**
+ * reverb <input> <output> <delay1> <attenuation1> [<delay2> <attenuation2> ...]
+ */
+int job_reverb(SoundRequestPtr req)
+{
+	int *delays, *percents;
+	FILE *inp, *out;
+	int num_echoes, i;
+	int result;
+
+	if(req->num_words < 5 || (req->num_words - 3) % 2 != 0)
+	{
+		fprintf(stderr, "reverb needs an input, an output and a delay and attenuation for each "
+						"echo.\n");
+		return 1;
+	}
+	if((inp = open_input(req, req->words[1])) == NULL)
+	{
+		return 1;
+	}
+	if((out = open_output(req, req->words[2])) == NULL)
+	{
+		fclose(inp);
+		return 1;
+	}
+
+	num_echoes = (req->num_words - 3) / 2;
+	delays = (int*)perf_malloc(num_echoes * sizeof(int));
+	percents = (int*)perf_malloc(num_echoes * sizeof(int));
+	for(i=0; i<num_echoes; i++)
+	{
+		delays[i] = atoi(req->words[3 + 2*i]);
+		percents[i] = atoi(req->words[4 + 2*i]);
+	}
+	/*The pool is already keeping the CPUs busy, so no reader thread*/
+	result = reverb_file(inp, out, delays, percents, num_echoes, 0);
+	free(delays);
+	free(percents);
+	fclose(inp);
+	fclose(out);
+	return result;
+}
+
+/**
+ * dtmf <input> <output>
+ */
+int job_dtmf(SoundRequestPtr req)
+{
+	FILE *inp, *out;
+	int result;
+
+	if(req->num_words != 3)
+	{
+		fprintf(stderr, "dtmf needs an input and an output.\n");
+		return 1;
+	}
+	if((inp = open_input(req, req->words[1])) == NULL)
+	{
+		return 1;
+	}
+	if((out = open_output(req, req->words[2])) == NULL)
+	{
+		fclose(inp);
+		return 1;
+	}
+	result = dtmf_decode(inp, out, 0);
+	fclose(inp);
+	fclose(out);
+	return result;
+}
+
+/**
+ * generate <output> <MONO | STEREO> <frequency> <bit-size> <sample rate> <amplitude> <duration>
+ */
+int job_generate(SoundRequestPtr req)
+{
+	SineProp sine;
+	FILE *out;
+
+	if(req->num_words != 2 + GENSINE_ARGS)
+	{
+		fprintf(stderr, "generate needs an output and all 6 parameters of gensine.\n");
+		return 1;
+	}
+	if(gensine_args(req->words + 2, &sine) != 0)
+	{
+		return 1;
+	}
+	if((out = open_output(req, req->words[1])) == NULL)
+	{
+		return 1;
+	}
+	gensine_write(out, &sine);
+	fclose(out);
+	return 0;
+}
+
+/**
+ * Opens an input of a job, either a path or, for "-", the first descriptor that was passed.
+ */
+FILE *open_input(SoundRequestPtr req, const char *name)
+{
+	FILE *inp;
+
+	if(strcmp(name, "-") != 0)
+	{
+		if((inp = fopen(name, "r")) == NULL)
+		{
+			fprintf(stderr, "Cannot open: %s\n", name);
+		}
+		return inp;
+	}
+	if(req->num_fds < 1 || req->fds[0] < 0 || (inp = fdopen(req->fds[0], "r")) == NULL)
+	{
+		fprintf(stderr, "No input descriptor was passed.\n");
+		return NULL;
+	}
+	req->fds[0] = -1;
+	return inp;
+}
+
+/**
+ * Opens an output of a job, either a path or, for "-", the second descriptor that was passed.
+ */
+FILE *open_output(SoundRequestPtr req, const char *name)
+{
+	FILE *out;
+
+	if(strcmp(name, "-") != 0)
+	{
+		if((out = fopen(name, "w")) == NULL)
+		{
+			fprintf(stderr, "Cannot open: %s\n", name);
+		}
+		return out;
+	}
+	if(req->num_fds < 2 || req->fds[1] < 0 || (out = fdopen(req->fds[1], "w")) == NULL)
+	{
+		fprintf(stderr, "No output descriptor was passed.\n");
+		return NULL;
+	}
+	req->fds[1] = -1;
+	return out;
+}
+
+/**
+ * Replies to "stats" with the latency totals of each kind of job.
+ */
+void send_stats(SoundRequestPtr req)
+{
+	char reply[MAX_REQUEST];
+	unsigned long long average;
+	int length = 0;
+	int i;
+
+	pthread_mutex_lock(&latency_lock);
+	length += sprintf(reply + length, "{");
+	for(i=0; i<NUM_JOBS; i++)
+	{
+		average = (latencies[i].count > 0) ? latencies[i].total_ns / latencies[i].count : 0;
+		length += sprintf(reply + length, "%s\"%s\": {\"count\": %llu, \"failed\": %llu, ",
+							(i > 0) ? ", " : "", job_names[i], latencies[i].count,
+							latencies[i].failed);
+		length += sprintf(reply + length, "\"avg_us\": %llu, \"max_us\": %llu}",
+							average / 1000, latencies[i].max_ns / 1000);
+	}
+	pthread_mutex_unlock(&latency_lock);
+	sprintf(reply + length, "}\n");
+	send_reply(req->sock, reply);
+}
+
+/**
+ * Sends the whole reply.  A client that has gone away is just ignored.
+ */
+void send_reply(int sock, const char *reply)
+{
+	int length = strlen(reply);
+	int sent;
+
+	while(length > 0 && (sent = write(sock, reply, length)) > 0)
+	{
+		reply += sent;
+		length -= sent;
+	}
+}
+
+/**
+ * Closes the connection and any descriptors no job took, and frees the request.
+ */
+void free_request(SoundRequestPtr req)
+{
+	int i;
+
+	for(i=0; i<req->num_fds; i++)
+	{
+		if(req->fds[i] >= 0)
+		{
+			close(req->fds[i]);
+		}
+	}
+	close(req->sock);
+	free(req);
+}
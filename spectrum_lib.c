@@ -0,0 +1,267 @@
+#include "spectrum_lib.h"
+#include "handle_lib.h"
+#include "fourier.h"
+#include "pool_lib.h"
+#include "perf_lib.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/*States of a cache entry*/
+#define ENTRY_PENDING 0
+#define ENTRY_WORKING 1
+#define ENTRY_READY 2
+#define ENTRY_FAILED 3
+
+typedef struct spectrum_entry *SpectrumEntryPtr;
+
+/**
+ * One window in the cache.  The samples and magnitudes are only there once it's ready.  The
+ * size and modification time are the file's when the window was asked for, so a file that
+ * has been rewritten since doesn't match it any more.
+ */
+typedef struct spectrum_entry
+{
+	char *file_name;
+	long long source_size;
+	long long source_mtime;
+	int start;
+	int window_size;
+	int num_bins;
+	int state;
+	int *samples;
+	double *magnitudes;
+} SpectrumEntry;
+
+/*The cache, most recently used first.  Everything here is protected by spectrum_lock.
+worker_running is set while a spectrum_worker task is queued or running in the thread pool, so
+there's never more than one.*/
+static SpectrumEntryPtr spectrum_cache[SPECTRUM_CACHE_SIZE];
+static int spectrum_cache_count = 0;
+static pthread_mutex_t spectrum_lock = PTHREAD_MUTEX_INITIALIZER;
+static int worker_running = 0;
+
+/*Only used by the worker task.  The file being looked at is kept open between windows.*/
+static SoundHandlePtr worker_handle = NULL;
+static char *worker_file_name = NULL;
+static long long worker_size;
+static long long worker_mtime;
+
+static void spectrum_worker(void *arg);
+static void compute_entry(SpectrumEntryPtr entry, const char *file_name);
+static void remove_entry(int i);
+static void free_entry(SpectrumEntryPtr entry);
+
+/**
+ * Looks up the window in the cache and copies it out if it's ready.  Otherwise it's queued
+ * for the worker task, which is handed to the thread pool if it isn't already there.
+ * Windows that are still waiting are dropped when a new one is asked for, since the user has
+ * already moved on from them, and so are windows of the file from before it was last
+ * changed.  See spectrum_lib.h.
+ */
+int spectrum_poll(const char *file_name, int start, int window_size, int num_bins,
+					int *samples, double *magnitudes)
+{
+	SpectrumEntryPtr entry = NULL;
+	struct stat source;
+	int i, found = -1;
+	int result = SPECTRUM_PENDING;
+
+	if(stat(file_name, &source) != 0)
+	{
+		return SPECTRUM_FAILED;
+	}
+
+	pthread_mutex_lock(&spectrum_lock);
+	/*Throw out anything from an older version of the file, except what the worker has*/
+	for(i=spectrum_cache_count-1; i>=0; i--)
+	{
+		entry = spectrum_cache[i];
+		if(entry->state != ENTRY_WORKING && strcmp(entry->file_name, file_name) == 0 &&
+				(entry->source_size != (long long)source.st_size ||
+				entry->source_mtime != (long long)source.st_mtime))
+		{
+			remove_entry(i);
+		}
+	}
+	for(i=0; i<spectrum_cache_count; i++)
+	{
+		entry = spectrum_cache[i];
+		if(entry->source_size == (long long)source.st_size &&
+				entry->source_mtime == (long long)source.st_mtime && entry->start == start &&
+				entry->window_size == window_size &&
+				entry->num_bins == num_bins && strcmp(entry->file_name, file_name) == 0)
+		{
+			found = i;
+			break;
+		}
+	}
+
+	if(found >= 0 && entry->state == ENTRY_FAILED)
+	{
+		/*Take it out so the file is tried again next time*/
+		remove_entry(found);
+		pthread_mutex_unlock(&spectrum_lock);
+		return SPECTRUM_FAILED;
+	}
+	if(found < 0)
+	{
+		for(i=spectrum_cache_count-1; i>=0; i--)
+		{
+			if(spectrum_cache[i]->state == ENTRY_PENDING)
+			{
+				remove_entry(i);
+			}
+		}
+		/*Throw out the one used longest ago, but not the one the worker has*/
+		if(spectrum_cache_count == SPECTRUM_CACHE_SIZE)
+		{
+			i = spectrum_cache_count - 1;
+			if(spectrum_cache[i]->state == ENTRY_WORKING)
+			{
+				i--;
+			}
+			remove_entry(i);
+		}
+		entry = (SpectrumEntryPtr)perf_malloc(sizeof(SpectrumEntry));
+		entry->file_name = strdup(file_name);
+		entry->source_size = source.st_size;
+		entry->source_mtime = source.st_mtime;
+		entry->start = start;
+		entry->window_size = window_size;
+		entry->num_bins = num_bins;
+		entry->state = ENTRY_PENDING;
+		entry->samples = NULL;
+		entry->magnitudes = NULL;
+		found = spectrum_cache_count++;
+
+		if(!worker_running)
+		{
+			worker_running = 1;
+			pool_spawn(spectrum_worker, NULL);
+		}
+	}
+
+	/*Move it to the front*/
+	for(i=found; i>0; i--)
+	{
+		spectrum_cache[i] = spectrum_cache[i-1];
+	}
+	spectrum_cache[0] = entry;
+
+	if(entry->state == ENTRY_READY)
+	{
+		memcpy(samples, entry->samples, (window_size + 1) * sizeof(int));
+		memcpy(magnitudes, entry->magnitudes, num_bins * sizeof(double));
+		result = SPECTRUM_READY;
+	}
+	pthread_mutex_unlock(&spectrum_lock);
+	return result;
+}
+
+/**
+ * Pool task that works on the newest pending window in the cache, one at a time, until there
+ * are none left.  The lock isn't held while the window is being worked out, so spectrum_poll
+ * never has to wait for it.
+ */
+static void spectrum_worker(void *arg)
+{
+	SpectrumEntryPtr entry;
+	char *file_name;
+	int i;
+
+	pthread_mutex_lock(&spectrum_lock);
+	while(1)
+	{
+		entry = NULL;
+		for(i=0; i<spectrum_cache_count && entry == NULL; i++)
+		{
+			if(spectrum_cache[i]->state == ENTRY_PENDING)
+			{
+				entry = spectrum_cache[i];
+			}
+		}
+		if(entry == NULL)
+		{
+			worker_running = 0;
+			pthread_mutex_unlock(&spectrum_lock);
+			return;
+		}
+		/*Nothing else changes or frees a working entry, so it's safe to use unlocked*/
+		entry->state = ENTRY_WORKING;
+		file_name = entry->file_name;
+		pthread_mutex_unlock(&spectrum_lock);
+
+		compute_entry(entry, file_name);
+
+		pthread_mutex_lock(&spectrum_lock);
+		entry->state = (entry->samples != NULL) ? ENTRY_READY : ENTRY_FAILED;
+	}
+}
+
+/**
+ * Reads the entry's window from the file and works out its spectrum.  The file is opened
+ * again if it isn't the one that's open, or if it has been changed since it was opened.  The
+ * samples and magnitudes are left NULL if the file can't be opened.
+ */
+static void compute_entry(SpectrumEntryPtr entry, const char *file_name)
+{
+	double *re, *im;
+	int k;
+
+	if(worker_handle == NULL || strcmp(worker_file_name, file_name) != 0 ||
+			worker_size != entry->source_size || worker_mtime != entry->source_mtime)
+	{
+		handle_close(worker_handle);
+		free(worker_file_name);
+		worker_handle = handle_open(file_name);
+		worker_file_name = strdup(file_name);
+		worker_size = entry->source_size;
+		worker_mtime = entry->source_mtime;
+	}
+	if(worker_handle == NULL)
+	{
+		return;
+	}
+
+	entry->magnitudes = (double*)perf_malloc((entry->num_bins + 1) * sizeof(double));
+	re = (double*)perf_malloc((entry->num_bins + 1) * sizeof(double));
+	im = (double*)perf_malloc((entry->num_bins + 1) * sizeof(double));
+	/*Plus 1 for the sample rate at the end*/
+	entry->samples = (int*)perf_malloc((entry->window_size + 1) * sizeof(int));
+
+	handle_read(worker_handle, entry->window_size, entry->start, entry->samples);
+	calc_spectrum(entry->samples, entry->window_size, entry->num_bins, re, im);
+	for(k=0; k<entry->num_bins; k++)
+	{
+		entry->magnitudes[k] = sqrt(re[k]*re[k] + im[k]*im[k]);
+	}
+	free(re);
+	free(im);
+}
+
+/**
+ * Takes entry "i" out of the cache and frees it.  spectrum_lock must be held.
+ */
+static void remove_entry(int i)
+{
+	free_entry(spectrum_cache[i]);
+	for(; i<spectrum_cache_count-1; i++)
+	{
+		spectrum_cache[i] = spectrum_cache[i+1];
+	}
+	spectrum_cache_count--;
+}
+
+/**
+ * Frees an entry and everything in it.
+ */
+static void free_entry(SpectrumEntryPtr entry)
+{
+	free(entry->file_name);
+	free(entry->samples);
+	free(entry->magnitudes);
+	free(entry);
+}
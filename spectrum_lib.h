@@ -0,0 +1,25 @@
+#ifndef SPECTRUM_LIB_H_
+#define SPECTRUM_LIB_H_
+
+/*Number of finished windows kept between calls*/
+#define SPECTRUM_CACHE_SIZE 64
+
+/*What spectrum_poll returns*/
+#define SPECTRUM_FAILED -1
+#define SPECTRUM_PENDING 0
+#define SPECTRUM_READY 1
+
+/**
+ * Looks up the window of "window_size" samples starting "start" percent of the way into the
+ * file, the same window get_samples in fourier.h gives.  If it has already been worked out its
+ * samples (plus the sample rate at the end, so window_size + 1 values) and the magnitudes of
+ * its first "num_bins" fourier bins are copied into "samples" and "magnitudes", and
+ * SPECTRUM_READY is returned.  Otherwise it is handed to the thread pool and SPECTRUM_PENDING
+ * is returned, and the caller should ask again later.  Only the newest window asked for is
+ * worked on, so any older ones still waiting are dropped.  Returns SPECTRUM_FAILED if the file
+ * couldn't be opened.
+ */
+int spectrum_poll(const char *file_name, int start, int window_size, int num_bins,
+					int *samples, double *magnitudes);
+
+#endif
@@ -1,4 +1,5 @@
 #include "input_lib.h"
+#include "perf_lib.h"
 
 /**
  * Part C: Split
@@ -12,6 +13,8 @@ int main(int argc, char* argv[])
 {
 	int ret_val;
 	
+	perf_init(&argc, argv);
+	
 	/*The "handle_input" function does all the real processing.*/
 	ret_val = handle_input(stdin, NULL, SPLIT);
 	
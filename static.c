@@ -2,17 +2,40 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <time.h>
-#include <math.h>
 #include "util.h"
+#include "noise_lib.h"
+#include "perf_lib.h"
+#include "pool_lib.h"
 
 #define NUM_ARGS 4
+/*Number of samples made between writes*/
+#define NOISE_BLOCK (1<<20)
+/*Number of samples in each piece handed to the pool*/
+#define NOISE_GRAIN (1<<14)
+
+typedef struct noise_job *NoiseJobPtr;
+
+/**
+ * The block being filled, shared by the pool's threads.
+ */
+typedef struct noise_job
+{
+	unsigned long long seed;
+	unsigned long long start;
+	unsigned *out;
+	int bit_size;
+} NoiseJob;
+
+void fill_range(void *arg, int from, int to);
 
 /**
  * Part D: Static
  * Output random data values according to the specified parameters to the standard output.
- * Each value will be between 0 and 2^(bit-size)-1
+ * Each value will be between 0 and 2^(bit-size)-1.  If a seed is given the output is always
+ * the same for that seed, no matter how many threads are used to make it.  Otherwise the
+ * seed comes from the time.
  *
- * Command Line Variables: static <bit-size> <number of samples> <sample rate>
+ * Command Line Variables: static <bit-size> <number of samples> <sample rate> [seed [threads]]
  * Return Values: 0 - Success; 1 - Failure (error written to stderr)
  */
 int main(int argc, char* argv[])
@@ -20,11 +43,14 @@ int main(int argc, char* argv[])
 	int bit_size;
 	int num_samples;
 	int sample_rate;
-	unsigned max_sample;
-	int i;
-	unsigned sample;
+	int i, count;
+	unsigned long long seed;
+	unsigned *samples;
+	NoiseJob job;
+	
+	perf_init(&argc, argv);
 	
-	if(argc != NUM_ARGS)
+	if(argc < NUM_ARGS || argc > NUM_ARGS + 2)
 	{
 		fprintf(stderr, "You must enter all 3 parameters");
 		return 1;
@@ -52,6 +78,10 @@ int main(int argc, char* argv[])
 		return(1);
 	}
 	
+	/*The seed and thread count are optional*/
+	seed = (argc > NUM_ARGS) ? strtoull(argv[4], NULL, 10) : (unsigned long long)time(NULL);
+	pool_init((argc > NUM_ARGS + 1) ? atoi(argv[5]) : 0);
+	
 	/*Print header info*/
 	printf("Header\n");
 	printf("FREQUENCY %d\n", sample_rate);
@@ -60,16 +90,39 @@ int main(int argc, char* argv[])
 	printf("SAMPLEBITS %d\n", bit_size);
 	printf("EndHeader\n");
 	
-	/*Print the "static" samples*/
-	i=0;
-	srand(time(NULL));
-	max_sample = (unsigned)(pow(2, bit_size))-1;
-	while(i<num_samples)
+	/*Print the "static" samples.  Each block is split between the pool's threads, and since
+	every sample only depends on the seed and its position the split doesn't change the output.*/
+	samples = (unsigned*)perf_malloc(NOISE_BLOCK * sizeof(unsigned));
+	job.seed = seed;
+	job.out = samples;
+	job.bit_size = bit_size;
+	for(i=0; i<num_samples; i+=NOISE_BLOCK)
 	{
-		sample = rand() % max_sample;
-		output_sample(stdout, sample, bit_size);
-		i++;
+		count = num_samples - i;
+		if(count > NOISE_BLOCK)
+		{
+			count = NOISE_BLOCK;
+		}
+		job.start = i;
+		pool_parallel_for(0, count, NOISE_GRAIN, fill_range, &job);
+		output_samples(stdout, samples, count, bit_size);
 	}
+	free(samples);
 	
 	return 0;
 }
+
+
+/**
+ * Pool function that fills samples "from" to "to" of the block.
+ */
+void fill_range(void *arg, int from, int to)
+{
+	NoiseJobPtr job = (NoiseJobPtr)arg;
+	unsigned long long perf_start;
+	
+	PERF_START(perf_start);
+	noise_fill(job->seed, job->start + from, job->out + from, to - from, job->bit_size);
+	PERF_STOP(PERF_COMPUTE_NS, "noise_fill", perf_start);
+	perf_add(PERF_SAMPLES_PROCESSED, to - from);
+}
@@ -1,4 +1,15 @@
 #include "util.h"
+#include "codec_lib.h"
+#include "perf_lib.h"
+#include "probes.h"
+
+/*Size of the byte buffers used when reading and writing blocks of samples*/
+#define INPUT_BUF_SIZE 16384
+#define OUTPUT_BUF_SIZE 4096
+/*Cutoff of the DC trackers' low pass.  Low enough that the level barely moves over a cycle of
+anything audible, high enough that it settles within a fraction of a second.*/
+#define DC_CUTOFF_HZ 2.0
+#define TWO_PI 6.283185307179586
 
 /**
  * Reads one sample from a file and puts it in the integer pointed to by value.  
@@ -28,6 +39,11 @@ int read_sample(FILE *inp, int bit_size, unsigned *value)
 		i++;
 		shift_amt = shift_amt + 8;
 	}
+	if(perf_enabled)
+	{
+		perf_add(PERF_BYTES_READ, i);
+		perf_add(PERF_SAMPLES_READ, i == byte_size);
+	}
 	return i;
 }
 
@@ -59,6 +75,233 @@ void output_sample(FILE *out, unsigned data, int bit_size)
 		putc(data>>16, out);
 		putc(data>>24, out);
 	}
+	if(perf_enabled)
+	{
+		perf_add(PERF_BYTES_WRITTEN, bit_size/8);
+		perf_add(PERF_SAMPLES_WRITTEN, 1);
+	}
+}
+
+/**
+ * Reads up to "count" samples from a file into the array pointed to by values.  This is the
+ * block version of read_sample.  The raw bytes are read a buffer at a time and unpacked by the
+ * codec for the bit size, so there's no check of the bit size for each sample.
+ * Returns how many complete samples were read.  Any trailing partial sample is dropped.
+ */
+int read_samples(FILE *inp, int bit_size, unsigned *values, int count)
+{
+	unsigned char buf[INPUT_BUF_SIZE];
+	const SampleCodec *codec = codec_get(bit_size, MONO);
+	int per_buf = INPUT_BUF_SIZE / codec->bytes_per_sample;
+	int num_read = 0;
+	int n, got;
+	unsigned long long start;
+	
+	while(num_read < count)
+	{
+		n = count - num_read;
+		if(n > per_buf)
+		{
+			n = per_buf;
+		}
+		PERF_START(start);
+		got = fread(buf, codec->bytes_per_sample, n, inp);
+		PERF_STOP(PERF_IO_WAIT_NS, "read_block", start);
+		codec->unpack(buf, values + num_read, got);
+		num_read += got;
+		if(got < n)
+		{
+			break;
+		}
+	}
+	SOUND_PROBE3(read_block, count, num_read, bit_size);
+	if(perf_enabled)
+	{
+		perf_add(PERF_BYTES_READ, num_read * codec->bytes_per_sample);
+		perf_add(PERF_SAMPLES_READ, num_read);
+	}
+	return num_read;
+}
+
+/**
+ * The raw little endian bytes of "count" samples are at the start of the values array.  This
+ * unpacks them in place so each one takes up a whole unsigned.  Since every sample takes at
+ * most 4 bytes, this works as long as we go from back to front.
+ */
+void unpack_samples(unsigned *values, int count, int bit_size)
+{
+	int i;
+	unsigned char *bytes = (unsigned char*)values;
+	
+	if(bit_size == 8)
+	{
+		for(i=count-1; i>=0; i--)
+		{
+			values[i] = bytes[i];
+		}
+	}
+	else if(bit_size == 16)
+	{
+		for(i=count-1; i>=0; i--)
+		{
+			values[i] = bytes[2*i] | (bytes[2*i+1]<<8);
+		}
+	}
+	else if(bit_size == 32)
+	{
+		for(i=0; i<count; i++)
+		{
+			values[i] = bytes[4*i] | (bytes[4*i+1]<<8) | (bytes[4*i+2]<<16) | 
+						((unsigned)bytes[4*i+3]<<24);
+		}
+	}
+}
+
+/**
+ * Writes "count" samples from the array pointed to by values out to the file.  This is the
+ * block version of output_sample, the bytes are packed into a buffer by the codec for the bit
+ * size and written in bulk.
+ */
+void output_samples(FILE *out, const unsigned *values, int count, int bit_size)
+{
+	unsigned char buf[OUTPUT_BUF_SIZE];
+	const SampleCodec *codec = codec_get(bit_size, MONO);
+	int bytes_per_sample = codec->bytes_per_sample;
+	int per_buf = OUTPUT_BUF_SIZE / bytes_per_sample;
+	int i, n;
+	unsigned long long start;
+	
+	for(i=0; i<count; i+=per_buf)
+	{
+		n = count - i;
+		if(n > per_buf)
+		{
+			n = per_buf;
+		}
+		codec->pack(values + i, buf, n);
+		PERF_START(start);
+		fwrite(buf, bytes_per_sample, n, out);
+		PERF_STOP(PERF_IO_WAIT_NS, "write_block", start);
+	}
+	SOUND_PROBE2(write_block, count, bit_size);
+	if(perf_enabled)
+	{
+		perf_add(PERF_BYTES_WRITTEN, count * bytes_per_sample);
+		perf_add(PERF_SAMPLES_WRITTEN, count);
+	}
+}
+
+/**
+ * Converts samples to floats so the DSP code can work on them.  No scaling is done, so the
+ * float values are the same as the sample values.  Note that a float only has 24 bits of
+ * precision, so 32-bit samples lose their lowest bits.
+ */
+void samples_to_float(const unsigned *in, float *out, int count)
+{
+	int i;
+	for(i=0; i<count; i++)
+	{
+		out[i] = (float)in[i];
+	}
+}
+
+/**
+ * Converts floats back to samples.  The values are rounded and clipped to the legal range
+ * for the bit size (0 to 2^bit_size-1).
+ */
+void float_to_samples(const float *in, unsigned *out, int count, int bit_size)
+{
+	int i;
+	double max_sample;
+	double value;
+	
+	/*Can't shift by 32, so the largest bit size is handled separately*/
+	if(bit_size == 32)
+	{
+		max_sample = 4294967295.0;
+	}
+	else
+	{
+		max_sample = (double)((1u<<bit_size) - 1);
+	}
+	
+	for(i=0; i<count; i++)
+	{
+		value = in[i] + 0.5;
+		if(value < 0.0)
+		{
+			value = 0.0;
+		}
+		else if(value > max_sample)
+		{
+			value = max_sample;
+		}
+		out[i] = (unsigned)value;
+	}
+}
+
+/**
+ * Converts doubles back to samples.  The values are rounded and clipped to the legal range
+ * for the bit size.
+ */
+void double_to_samples(const double *in, unsigned *out, int count, int bit_size)
+{
+	int i;
+	double max_sample;
+	double value;
+	
+	max_sample = (bit_size == 32) ? 4294967295.0 : (double)((1u<<bit_size) - 1);
+	for(i=0; i<count; i++)
+	{
+		value = in[i] + 0.5;
+		if(value < 0.0)
+		{
+			value = 0.0;
+		}
+		else if(value > max_sample)
+		{
+			value = max_sample;
+		}
+		out[i] = (unsigned)value;
+	}
+}
+
+/**
+ * Sets up a DC tracker.  The rate is the usual small angle version of a one pole low pass
+ * coefficient, which is plenty accurate at this cutoff.
+ */
+void dc_init(DcTrackerPtr dc, int sample_rate, int channels)
+{
+	dc->level[0] = 0.0;
+	dc->level[1] = 0.0;
+	dc->rate = (sample_rate > 0) ? TWO_PI * DC_CUTOFF_HZ / sample_rate : 0.0;
+	dc->channels = channels;
+	dc->started = 0;
+}
+
+/**
+ * Splits the samples into the signal and its DC level.  The level each sample is taken from
+ * is the one before it, so the very first sample of each channel is its own level.
+ */
+void dc_split(DcTrackerPtr dc, const unsigned *in, double *ac, double *level, int count)
+{
+	int i, c;
+
+	if(!dc->started && count >= dc->channels)
+	{
+		for(c=0; c<dc->channels; c++)
+		{
+			dc->level[c] = in[c];
+		}
+		dc->started = 1;
+	}
+	for(i=0; i<count; i++)
+	{
+		c = i % dc->channels;
+		level[i] = dc->level[c];
+		ac[i] = in[i] - level[i];
+		dc->level[c] += dc->rate * ac[i];
+	}
 }
 
 /**
@@ -66,18 +309,26 @@ void output_sample(FILE *out, unsigned data, int bit_size)
  */
 void print_header(int sample_freq, int number_of_samples, int mono_stereo, int bit_size)
 {
-	printf("Header\n");
-	printf("FREQUENCY %d\n", sample_freq);
-	printf("SAMPLE %d\n", number_of_samples);
+	write_header(stdout, sample_freq, number_of_samples, mono_stereo, bit_size);
+}
+
+/**
+ * Writes the header information provided to the file.
+ */
+void write_header(FILE *out, int sample_freq, int number_of_samples, int mono_stereo, 
+					int bit_size)
+{
+	fprintf(out, "Header\n");
+	fprintf(out, "FREQUENCY %d\n", sample_freq);
+	fprintf(out, "SAMPLE %d\n", number_of_samples);
 	if(mono_stereo == MONO)
 	{
-		printf("CHANNELS MONO\n");
+		fprintf(out, "CHANNELS MONO\n");
 	}
 	else
 	{
-		printf("CHANNELS STEREO\n");
+		fprintf(out, "CHANNELS STEREO\n");
 	}
-	printf("SAMPLEBITS %d\n", bit_size);
-	printf("EndHeader\n");
+	fprintf(out, "SAMPLEBITS %d\n", bit_size);
+	fprintf(out, "EndHeader\n");
 }
-
@@ -20,9 +20,79 @@ void output_sample(FILE *out, unsigned data, int bit_size);
  */
 int read_sample(FILE *inp, int bit_size, unsigned *value);
 
+/**
+ * Reads up to "count" samples from a file into the array pointed to by values.  This is the
+ * block version of read_sample, it reads the data a buffer at a time and unpacks it.
+ * Returns how many complete samples were read.  Any trailing partial sample is dropped.
+ */
+int read_samples(FILE *inp, int bit_size, unsigned *values, int count);
+
+/**
+ * The raw little endian bytes of "count" samples are at the start of the values array.  This
+ * unpacks them in place so each one takes up a whole unsigned.
+ */
+void unpack_samples(unsigned *values, int count, int bit_size);
+
+/**
+ * Writes "count" samples from the array pointed to by values out to the file.  This is the
+ * block version of output_sample, the bytes are packed into a buffer and written in bulk.
+ */
+void output_samples(FILE *out, const unsigned *values, int count, int bit_size);
+
+/**
+ * Converts samples to floats so the DSP code can work on them.  No scaling is done, so the
+ * float values are the same as the sample values.  Note that a float only has 24 bits of
+ * precision, so 32-bit samples lose their lowest bits.
+ */
+void samples_to_float(const unsigned *in, float *out, int count);
+
+/**
+ * Converts floats back to samples.  The values are rounded and clipped to the legal range
+ * for the bit size (0 to 2^bit_size-1).
+ */
+void float_to_samples(const float *in, unsigned *out, int count, int bit_size);
+
+/**
+ * Converts doubles back to samples, rounded and clipped the same way as float_to_samples.
+ * Doubles hold every 32-bit sample exactly, so values that weren't changed come back the same.
+ */
+void double_to_samples(const double *in, unsigned *out, int count, int bit_size);
+
+typedef struct dc_tracker *DcTrackerPtr;
+
+/**
+ * Follows the DC level of each channel of a stream of samples.  The samples here are written
+ * from 0 up (a tone runs from 0 to its amplitude and silence is 0), so DSP code that wants a
+ * signal centred on 0 has to take off the signal's own level rather than the middle of the
+ * range.  The level starts at the first sample and then follows a slow one pole low pass.
+ */
+typedef struct dc_tracker
+{
+	double level[2];
+	double rate;		/*How far the level moves towards each new sample*/
+	int channels;
+	int started;
+} DcTracker;
+
+/**
+ * Sets up a tracker for a stream with the given sample rate and number of channels.
+ */
+void dc_init(DcTrackerPtr dc, int sample_rate, int channels);
+
+/**
+ * Splits "count" interleaved samples into the signal about its DC level, put in "ac", and the
+ * level each sample was taken from, put in "level", so ac[i] + level[i] is the sample.
+ */
+void dc_split(DcTrackerPtr dc, const unsigned *in, double *ac, double *level, int count);
+
 /**
  * Prints the header information provided
  */
 void print_header(int freq, int number_of_samples, int mono_stereo, int bit_size);
 
+/**
+ * Writes the header information provided to the file.
+ */
+void write_header(FILE *out, int freq, int number_of_samples, int mono_stereo, int bit_size);
+
 #endif